@@ -0,0 +1,242 @@
+"""Binary command protocol for the ESP32 turret (WebSocket binary frames).
+
+Mirrors ESP32_Servo_Controller/include/bin_proto.h: little-endian, packed,
+byte 0 is the opcode, angles in centidegrees, ids are u32.
+"""
+import struct
+
+# opcodes
+MOVE = 0x01
+MOVE_DIR = 0x02
+STOP = 0x03
+CANCEL = 0x04
+STATUS_REQ = 0x05
+TRACE_DUMP = 0x06
+STATS_REQ = 0x07
+PING = 0x08
+SYNC = 0x09
+MOVE_VEL = 0x0A
+TRACK_ERR = 0x0B
+TRAJECTORY = 0x0C
+COALESCE = 0x0D
+KEEPALIVE = 0x0E
+ACK = 0x81
+STATUS = 0x82
+TRACE = 0x83
+STATS = 0x84
+PONG = 0x85
+
+MOVE_QUEUE = 0x01    # MOVE flags byte, after duration_ms
+
+# priority classes (motion commands); a higher one preempts a lower one and
+# never waits behind it
+PRIO_LOW, PRIO_NORMAL, PRIO_HIGH, PRIO_URGENT = range(4)
+
+STATES = ["MOVING", "SUCCESS", "CANCELLED", "PREEMPTED", "TIMEOUT",
+          "STOPPED", "ERROR", "IDLE", "BUSY", "EXPIRED"]
+ERRORS = [None, "not_active", "id_too_long", "queue_full", "not_synced", "bad_time", "bad_trajectory",
+          "busy"]
+
+_DIR = {"NONE": 0, "LEFT": 1, "DOWN": 1, "RIGHT": 2, "UP": 2}
+
+_MOVE = struct.Struct("<BIhh")
+_MOVE_DIR = struct.Struct("<BIB")
+_MOVE_VEL = struct.Struct("<BIhh")
+_TRACK_ERR = struct.Struct("<BIhhHHHHQ")
+_TRAJ_HDR = struct.Struct("<BIHH")
+_TRAJ_POINT = struct.Struct("<hhH")
+_COALESCE = struct.Struct("<BBH")
+_ID_ONLY = struct.Struct("<BI")
+_STATUS = struct.Struct("<BIBBhh")
+_PROGRESS = struct.Struct("<HH")
+_TRACE_HDR = struct.Struct("<BHBB")
+_TRACE_REC = struct.Struct("<IBBBx6I")
+_PING = struct.Struct("<BIQ")
+_PONG = struct.Struct("<BIQQQ")
+_SYNC = _PONG  # same layout, other direction
+_EXECUTE_AT = struct.Struct("<Q")
+_DURATION = struct.Struct("<H")
+_SCHED = struct.Struct("<BQ")
+_LEASE = struct.Struct("<H")
+
+OPS = ["MOVE", "MOVE_DIR", "STOP", "CANCEL", "MOVE_VEL", "TRACK_ERR", "TRAJECTORY"]
+MSG_TYPES = ["MOVE", "MOVE_DIR", "STOP", "CANCEL", "STATUS_REQ", "TRACE_DUMP", "STATS", "PING", "SYNC",
+             "MOVE_VEL", "TRACK_ERR", "TRAJECTORY", "COALESCE", "KEEPALIVE", "OTHER"]
+_STATS = struct.Struct("<BI%dIII2H9I%dI%dI" % ((len(MSG_TYPES),) * 3))
+_STATS_FIELDS = ["parse_fail", "queue_full", "ring_hwm", "queue_hwm", "preempted", "cancelled",
+                 "timeouts", "expired", "step_overruns", "status_dropped", "coalesced", "min_free_heap", "motion_stack_free"]
+TRACE_STAMPS = ["rx", "parsed", "acked", "dequeued", "first_write", "status"]
+
+
+def _at(execute_at, sched=b""):
+    if sched:
+        return _EXECUTE_AT.pack(execute_at or 0) + sched
+    return _EXECUTE_AT.pack(execute_at) if execute_at else b""
+
+
+def _sched(priority, deadline, lease_ms=None):
+    """Optional tail of every motion command. deadline: server clock in us;
+    a command that hasn't started by then is dropped with EXPIRED.
+    lease_ms (MOVE_DIR/MOVE_VEL only) comes after it."""
+    if priority == PRIO_NORMAL and not deadline and not lease_ms:
+        return b""
+    sched = _SCHED.pack(max(PRIO_LOW, min(PRIO_URGENT, priority)), deadline or 0)
+    return sched + _LEASE.pack(min(60000, lease_ms)) if lease_ms else sched
+
+
+def move(cmd_id, pan, tilt, execute_at=None, duration_ms=None, queue=False, priority=PRIO_NORMAL, deadline=None):
+    """execute_at: server clock in us (the one answering SYNC_REQ).
+    duration_ms: stretch the move to this long (the firmware's limits still apply).
+    queue: wait for earlier MOVEs instead of preempting, and blend through them."""
+    frame = _MOVE.pack(MOVE, cmd_id, round(pan * 100), round(tilt * 100))
+    sched = _sched(priority, deadline)
+    if queue or sched:
+        return (frame + _EXECUTE_AT.pack(execute_at or 0) + _DURATION.pack(min(60000, duration_ms or 0))
+                + bytes([MOVE_QUEUE if queue else 0]) + sched)
+    if duration_ms:
+        return frame + _EXECUTE_AT.pack(execute_at or 0) + _DURATION.pack(min(60000, duration_ms))
+    return frame + _at(execute_at)
+
+
+def move_dir(cmd_id, pan_dir="NONE", tilt_dir="NONE", speed=1, execute_at=None, priority=PRIO_NORMAL,
+             deadline=None, lease_ms=None):
+    """lease_ms: stop (brake, then TIMEOUT) this long after the start or the
+    last keepalive(cmd_id), instead of after COMMAND_TIMEOUT_MS."""
+    packed = (_DIR[pan_dir] << 6) | (_DIR[tilt_dir] << 4) | (max(1, min(10, speed)) & 0x0F)
+    return _MOVE_DIR.pack(MOVE_DIR, cmd_id, packed) + _at(execute_at, _sched(priority, deadline, lease_ms))
+
+
+def move_vel(cmd_id, pan_dps, tilt_dps, execute_at=None, priority=PRIO_NORMAL, deadline=None, lease_ms=None):
+    """Signed deg/s per axis (sent as centideg/s). Same id as the running
+    MOVE_VEL updates it in place. lease_ms as for move_dir."""
+    cdps = lambda v: max(-32700, min(32700, round(v * 100)))
+    return (_MOVE_VEL.pack(MOVE_VEL, cmd_id, cdps(pan_dps), cdps(tilt_dps))
+            + _at(execute_at, _sched(priority, deadline, lease_ms)))
+
+
+def keepalive(cmd_id):
+    """Renews the lease of the running MOVE_DIR/MOVE_VEL. No ACK, no reply."""
+    return _ID_ONLY.pack(KEEPALIVE, cmd_id)
+
+
+def track_err(cmd_id, dx, dy, width=0, height=0, fov_h=0.0, fov_v=0.0, frame_us=0, priority=PRIO_NORMAL,
+              deadline=None):
+    """Target pixels off the image center (+dx pan right, +dy tilt up),
+    frame size and field of view in degrees (0 = firmware defaults),
+    capture time on the server clock (0 = on arrival)."""
+    px = lambda v: max(-32767, min(32767, round(v)))
+    return _TRACK_ERR.pack(TRACK_ERR, cmd_id, px(dx), px(dy), width, height,
+                           round(fov_h * 100), round(fov_v * 100), frame_us) + _sched(priority, deadline)
+
+
+TRAJ_MAX_POINTS = 512
+
+
+def trajectory(cmd_id, points, report_ms=0, priority=PRIO_NORMAL, deadline=None):
+    """points: (pan, tilt, dt_ms) waypoints in degrees, dt_ms after the
+    previous one (the first: after the start); up to TRAJ_MAX_POINTS.
+    report_ms: progress STATUS (MOVING with point/points) this often, 0 = none."""
+    frame = _TRAJ_HDR.pack(TRAJECTORY, cmd_id, len(points), max(0, min(60000, report_ms)))
+    return (frame + b"".join(_TRAJ_POINT.pack(round(p * 100), round(t * 100), max(0, min(65535, round(dt))))
+                             for p, t, dt in points) + _sched(priority, deadline))
+
+
+def coalesce(on=True, report_ms=0):
+    """Latest-wins MOVEs for the rest of this connection: plain MOVEs (no
+    execute_at, duration_ms or queue) get no ACK and no STATUS of their
+    own, each replaces the target being followed. report_ms: position
+    STATUS (MOVING, id of the newest) this often, 0 = none. No reply."""
+    return _COALESCE.pack(COALESCE, 1 if on else 0, max(0, min(60000, report_ms)))
+
+
+def stop(cmd_id=0):
+    return _ID_ONLY.pack(STOP, cmd_id)
+
+
+def cancel(cmd_id):
+    return _ID_ONLY.pack(CANCEL, cmd_id)
+
+
+def status_req():
+    return bytes([STATUS_REQ])
+
+
+def trace_dump():
+    return bytes([TRACE_DUMP])
+
+
+def stats_req():
+    return bytes([STATS_REQ])
+
+
+def ping(seq, t_us):
+    return _PING.pack(PING, seq & 0xFFFFFFFF, t_us)
+
+
+def sync(seq, t_us, rx_us, tx_us):
+    """Answer to the ESP32's SYNC_REQ (JSON: same fields, type "SYNC")."""
+    return _SYNC.pack(SYNC, seq, t_us, rx_us, tx_us)
+
+
+def trace_tag(cmd_id):
+    """The u32 a trace record carries for this id (FNV-1a for JSON ids)."""
+    if isinstance(cmd_id, int):
+        return cmd_id
+    h = 2166136261
+    for b in cmd_id.encode()[:23]:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def trace_breakdown(rec):
+    """Per-stage latency in microseconds for one decoded trace record.
+
+    Stages that did not happen (e.g. no servo write) are None.
+    """
+    def span(a, b):
+        if not rec[a] or not rec[b]:
+            return None
+        return (rec[b] - rec[a]) & 0xFFFFFFFF
+
+    return {"parse": span("rx", "parsed"), "ack": span("parsed", "acked"),
+            "queue": span("acked", "dequeued"), "to_first_write": span("dequeued", "first_write"),
+            "motion": span("first_write", "status"), "total": span("rx", "status")}
+
+
+def decode(frame):
+    """Turn an ESP32 binary frame into the same dict the JSON protocol gives."""
+    op = frame[0]
+    if op == ACK:
+        _, cmd_id = _ID_ONLY.unpack_from(frame)
+        return {"type": "ACK", "id": str(cmd_id)}
+    if op == STATUS:
+        _, cmd_id, state, error, pan, tilt = _STATUS.unpack_from(frame)
+        msg = {"type": "STATUS", "id": str(cmd_id), "state": STATES[state],
+               "pan": pan / 100.0, "tilt": tilt / 100.0}
+        if ERRORS[error]:
+            msg["error"] = ERRORS[error]
+        if len(frame) >= _STATUS.size + _PROGRESS.size:
+            msg["point"], msg["points"] = _PROGRESS.unpack_from(frame, _STATUS.size)
+        return msg
+    if op == TRACE:
+        _, seq, count, last = _TRACE_HDR.unpack_from(frame)
+        records = []
+        for i in range(count):
+            tag, cmd_op, state, error, *stamps = _TRACE_REC.unpack_from(frame, _TRACE_HDR.size + i * _TRACE_REC.size)
+            rec = {"tag": tag, "op": OPS[cmd_op], "state": STATES[state], "error": ERRORS[error]}
+            rec.update(zip(TRACE_STAMPS, stamps))
+            records.append(rec)
+        return {"type": "TRACE", "seq": seq, "last": bool(last), "records": records}
+    if op == STATS:
+        v = _STATS.unpack_from(frame)
+        n = len(MSG_TYPES)
+        rx, rest = v[2:2 + n], v[2 + n:]
+        msg = {"type": "STATS", "uptime_ms": v[1], "rx": dict(zip(MSG_TYPES, rx))}
+        msg.update(zip(_STATS_FIELDS, rest))
+        avg, mx = rest[len(_STATS_FIELDS):][:n], rest[len(_STATS_FIELDS):][n:]
+        msg["handler_us"] = {t: [a, m] for t, a, m in zip(MSG_TYPES, avg, mx)}
+        return msg
+    if op == PONG:
+        _, seq, t_us, rx_us, tx_us = _PONG.unpack_from(frame)
+        return {"type": "PONG", "seq": seq, "t": t_us, "rx_us": rx_us, "tx_us": tx_us}
+    return {"type": "UNKNOWN", "op": op}
@@ -0,0 +1,95 @@
+"""Link latency probe for the ESP32 turret (PING/PONG).
+
+The server stamps each PING with its monotonic clock (t1); the ESP32 echoes
+it with esp_timer_get_time() at receive (t2) and just before sending the
+PONG (t3); the server stamps the PONG on arrival (t4).
+
+    rtt    = (t4 - t1) - (t3 - t2)          # time on the wire, both ways
+    offset = ((t2 - t1) + (t3 - t4)) / 2    # ESP32 clock minus server clock
+
+The two clocks are unrelated, so one-way delays are only estimates: they
+use the offset from the lowest-RTT sample in the window, where queueing is
+smallest and the path is most likely symmetric. All times in microseconds.
+"""
+import time
+from collections import deque
+
+WINDOW = 500          # samples kept for the percentiles (~100 s at 5 Hz)
+MAX_OUTSTANDING = 64  # PINGs that never got a PONG are forgotten after this
+
+
+def now_us():
+    return time.monotonic_ns() // 1000
+
+
+def _percentile(sorted_vals, p):
+    if not sorted_vals:
+        return None
+    i = min(len(sorted_vals) - 1, int(round(p / 100.0 * (len(sorted_vals) - 1))))
+    return sorted_vals[i]
+
+
+class LinkProbe:
+    def __init__(self, window=WINDOW):
+        self.seq = 0
+        self.sent = {}                      # seq -> t1
+        self.samples = deque(maxlen=window)  # (rtt, offset, up, down) per PONG
+        self.lost = 0
+
+    def ping(self):
+        """Next PING as a JSON-ready dict (bin_proto.ping(seq, t) for binary)."""
+        self.seq = (self.seq + 1) & 0xFFFFFFFF
+        t1 = now_us()
+        self.sent[self.seq] = t1
+        if len(self.sent) > MAX_OUTSTANDING:
+            del self.sent[min(self.sent)]
+            self.lost += 1
+        return {"type": "PING", "seq": self.seq, "t": t1}
+
+    def on_pong(self, msg, t4=None):
+        """Record a decoded PONG; returns the sample or None if unmatched."""
+        t4 = now_us() if t4 is None else t4
+        t1 = self.sent.pop(msg.get("seq"), None)
+        if t1 is None or t1 != msg.get("t"):
+            return None
+        t2, t3 = msg["rx_us"], msg["tx_us"]
+        rtt = (t4 - t1) - (t3 - t2)
+        offset = ((t2 - t1) + (t3 - t4)) / 2.0
+        sample = (rtt, offset, t2 - t1, t4 - t3)
+        self.samples.append(sample)
+        return sample
+
+    def offset_us(self):
+        """Best clock-offset estimate (ESP32 minus server), or None."""
+        if not self.samples:
+            return None
+        return min(self.samples)[1]
+
+    def to_esp_us(self, server_us):
+        """Server monotonic time -> ESP32 esp_timer time."""
+        off = self.offset_us()
+        return None if off is None else int(server_us + off)
+
+    def summary(self):
+        if not self.samples:
+            return None
+        rtts = sorted(s[0] for s in self.samples)
+        off = self.offset_us()
+        # one-way: raw (t2 - t1) / (t4 - t3) with the best offset taken out
+        ups = sorted(s[2] - off for s in self.samples)
+        downs = sorted(s[3] + off for s in self.samples)
+        return {"n": len(rtts), "lost": self.lost,
+                "rtt_p50": _percentile(rtts, 50), "rtt_p99": _percentile(rtts, 99),
+                "rtt_min": rtts[0], "rtt_max": rtts[-1],
+                "up_p50": _percentile(ups, 50), "down_p50": _percentile(downs, 50),
+                "offset": off}
+
+    def format(self):
+        s = self.summary()
+        if s is None:
+            return "no samples"
+        ms = lambda us: us / 1000.0
+        return (f"RTT p50 {ms(s['rtt_p50']):.1f} ms  p99 {ms(s['rtt_p99']):.1f} ms  "
+                f"(min {ms(s['rtt_min']):.1f} / max {ms(s['rtt_max']):.1f}, n={s['n']}, lost {s['lost']})  "
+                f"up~{ms(s['up_p50']):.1f} down~{ms(s['down_p50']):.1f} ms  "
+                f"offset {ms(s['offset']):+.1f} ms")
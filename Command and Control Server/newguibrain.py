@@ -3,11 +3,20 @@ from PyQt5.QtWidgets import QApplication, QWidget, QVBoxLayout, QTextEdit, QLabe
 from PyQt5.QtGui import QImage, QPixmap
 from PyQt5.QtCore import QTimer, Qt, QObject, pyqtSignal, pyqtSlot
 import websockets
+from link_probe import LinkProbe, now_us
 
 # CONFIG
 WS_PORT = 8080
 STEP_RADIUS = 50     # pixels tolerance to consider “centered”
 MOVE_SPEED = 2       # degrees per step for directional MOVE
+PING_INTERVAL = 0.2  # seconds between latency probes (link_probe.py)
+PROBE_LOG_EVERY = 25 # log RTT percentiles every N PONGs (~5 s)
+EXEC_LEAD_MS = 0     # >0: MOVE_DIR carries execute_at = frame time + this, so
+                     # every command lands the same delay after its frame
+                     # (pick it above the [LINK] one-way p99)
+LEASE_MS = 150       # >0: MOVE_DIR runs on a lease, renewed by a KEEPALIVE every
+                     # frame the target is seen; when the target (or the link)
+                     # is lost the turret brakes to a stop on its own
 
 # ---------------- WebSocket SERVER -----------------
 class WsServer(QObject):
@@ -18,6 +27,7 @@ class WsServer(QObject):
         self.port = port
         self.loop = asyncio.new_event_loop()
         self.connected_clients = set()
+        self.probe = LinkProbe()
         self.thread = threading.Thread(target=self.run_loop, daemon=True)
         self.thread.start()
 
@@ -43,10 +53,22 @@ class WsServer(QObject):
         self.connected_clients.add(websocket)
         client_ip = websocket.remote_address[0]
         self.sig_log.emit(f"[CONNECT] Client connected: {client_ip} on path {path}")
+        pinger = asyncio.ensure_future(self.ping_task(websocket))
         try:
             async for message in websocket:
-                self.sig_log.emit(f"[RX] {message}")
+                rx_us = now_us()
                 data = json.loads(message)
+                if data.get("type")=="SYNC_REQ":
+                    # the ESP32 keeps its own offset to our clock for execute_at
+                    await websocket.send(json.dumps({"type":"SYNC","seq":data.get("seq"),"t":data.get("t"),
+                                                     "rx_us":rx_us,"tx_us":now_us()}))
+                    continue
+                if data.get("type")=="PONG":
+                    # every 200 ms, so only the percentiles go to the log
+                    if self.probe.on_pong(data, rx_us) and len(self.probe.samples) % PROBE_LOG_EVERY == 0:
+                        self.sig_log.emit(f"[LINK] {self.probe.format()}")
+                    continue
+                self.sig_log.emit(f"[RX] {message}")
                 if data.get("type")=="HELLO":
                     # Simple HELLO ACK response
                     await websocket.send(json.dumps({"type":"HELLO_ACK"}))
@@ -58,11 +80,17 @@ class WsServer(QObject):
             if not isinstance(e, (websockets.exceptions.ConnectionClosedOK, websockets.exceptions.ConnectionClosedError)):
                 self.sig_log.emit(f"[ERROR] {type(e).__name__}: {e}")
         finally:
+            pinger.cancel()
             if websocket in self.connected_clients:
                 self.connected_clients.remove(websocket)
             self.sig_log.emit(f"[DISCONNECT] Client disconnected: {client_ip}")
 
-    def broadcast_json(self, obj):
+    async def ping_task(self, websocket):
+        while True:
+            await asyncio.sleep(PING_INTERVAL)
+            await websocket.send(json.dumps(self.probe.ping()))
+
+    def broadcast_json(self, obj, quiet=False):
         msg = json.dumps(obj)
         # Use a copy of the set in case clients disconnect during broadcast
         for ws in list(self.connected_clients):
@@ -74,7 +102,8 @@ class WsServer(QObject):
                     future.result(timeout=0.1) 
                 except Exception as e: 
                     self.sig_log.emit(f"[ERROR] broadcast: {e}")
-        self.sig_log.emit(f"[TX] {msg}")
+        if not quiet:
+            self.sig_log.emit(f"[TX] {msg}")
 
 # ---------------- PyQt5 GUI & CV Tracking -----------------
 class MainWindow(QWidget):
@@ -108,6 +137,7 @@ class MainWindow(QWidget):
         # Tracking State
         self.last_cx,self.last_cy=None,None
         self.last_pan_dir,self.last_tilt_dir="NONE","NONE" # Initialize to NONE
+        self.last_dir_id=None # MOVE_DIR whose lease the keepalives renew
         
         # Timer for Frame Update
         self.timer = QTimer(); 
@@ -118,6 +148,7 @@ class MainWindow(QWidget):
     def update_frame(self):
         ret, frame = self.cap.read()
         if not ret: return
+        frame_us = now_us()
         
         # Image Processing for Red Tracking
         frame_blur = cv2.GaussianBlur(frame,(7,7),0)
@@ -153,6 +184,7 @@ class MainWindow(QWidget):
         direction="No Target"
         pan_dir,tilt_dir="NONE","NONE"
         cx,cy=None,None
+        seen=False
         
         if target_contour is not None:
             # Draw bounding box
@@ -165,6 +197,7 @@ class MainWindow(QWidget):
                 cx=int(M["m10"]/M["m00"])
                 cy=int(M["m01"]/M["m00"])
                 self.last_cx,self.last_cy=cx,cy
+                seen=True
                 
                 cv2.circle(frame,(cx,cy),6,(0,0,255),-1)
                 
@@ -194,9 +227,22 @@ class MainWindow(QWidget):
                         "tilt_dir":tilt_dir,
                         "speed":MOVE_SPEED
                     }
+                    if EXEC_LEAD_MS > 0:
+                        msg["execute_at"] = frame_us + EXEC_LEAD_MS * 1000
+                    if LEASE_MS > 0:
+                        msg["lease_ms"] = LEASE_MS
                     self.ws_server.broadcast_json(msg)
                     self.last_pan_dir = pan_dir
                     self.last_tilt_dir = tilt_dir
+                    self.last_dir_id = msg["id"]
+                elif LEASE_MS > 0 and (pan_dir != "NONE" or tilt_dir != "NONE"):
+                    # same direction: keep it going for another lease
+                    self.ws_server.broadcast_json({"type":"KEEPALIVE","id":self.last_dir_id}, quiet=True)
+
+        if LEASE_MS > 0 and not seen:
+            # no keepalive: the lease runs out and the turret stops; send
+            # a fresh MOVE_DIR once the target is back
+            self.last_pan_dir,self.last_tilt_dir="NONE","NONE"
 
         # Display the current tracking status
         cv2.putText(frame,direction,(20,30),cv2.FONT_HERSHEY_SIMPLEX,1,(255,255,255),2)
@@ -13,10 +13,18 @@ from PyQt5.QtGui import QImage, QPixmap
 from PyQt5.QtCore import QTimer, Qt, QObject, pyqtSignal, pyqtSlot
 import websockets
 
+from link_probe import now_us
+
 # CONFIG
 WS_HOST = "ws://127.0.0.1:8080"  # adjust to your server
 STEP_RADIUS = 50                 # pixels tolerance to consider “centered”
-MOVE_SPEED = 2                   # degrees per step for directional MOVE
+KP = 0.15                        # deg/s of MOVE_VEL per pixel off center
+VEL_EPS = 2.0                    # deg/s change worth a new MOVE_VEL
+VEL_REFRESH_S = 1.0              # resend at least this often (firmware times out at 4 s)
+# On-device loop: send the pixel error of every frame as TRACK_ERR and let
+# the ESP32 run the controller; False falls back to MOVE_VEL from here.
+ON_DEVICE_LOOP = True
+CAM_FOV_H, CAM_FOV_V = 60.0, 45.0  # degrees; measure for your camera
 
 # ---------------- WebSocket client -----------------
 class WsClient(QObject):
@@ -42,10 +50,11 @@ class WsClient(QObject):
             self.sig_log.emit(f"[WS ERROR] {e}")
             return
 
-    def send_json(self, obj):
+    def send_json(self, obj, log=True):
         if self.ws and self.ws.open:
             asyncio.run_coroutine_threadsafe(self.ws.send(json.dumps(obj)), self.loop)
-            self.sig_log.emit(f"[TX] {obj}")
+            if log:
+                self.sig_log.emit(f"[TX] {obj}")
 
 # ---------------- Main GUI -----------------
 class MainWindow(QWidget):
@@ -78,7 +87,11 @@ class MainWindow(QWidget):
         self.cap.set(cv2.CAP_PROP_FRAME_HEIGHT, 480)
 
         self.last_cx, self.last_cy = None, None
-        self.last_pan_dir, self.last_tilt_dir = None, None
+        # one MOVE_VEL id for the whole session: the firmware updates the
+        # running command in place instead of preempting it
+        self.vel_id = uuid.uuid4().hex[:12]
+        self.last_vel = None
+        self.last_vel_sent = 0.0
 
         # Timer to grab frames
         self.timer = QTimer()
@@ -90,6 +103,8 @@ class MainWindow(QWidget):
         ret, frame = self.cap.read()
         if not ret:
             return
+        # capture time on the monotonic clock that answers the ESP32's SYNC_REQ
+        frame_us = now_us()
 
         frame_blur = cv2.GaussianBlur(frame, (7, 7), 0)
         hsv = cv2.cvtColor(frame_blur, cv2.COLOR_BGR2HSV)
@@ -126,7 +141,7 @@ class MainWindow(QWidget):
         cv2.circle(frame, (center_x, center_y), 6, (0, 255, 255), -1)
 
         direction = "No Target"
-        pan_dir, tilt_dir = "NONE", "NONE"
+        pan_dps, tilt_dps = 0.0, 0.0
         cx, cy = None, None
 
         if target_contour is not None:
@@ -142,14 +157,21 @@ class MainWindow(QWidget):
 
                 dx, dy = cx - center_x, cy - center_y
 
+                if ON_DEVICE_LOOP:
+                    # +dx pans right, +dy tilts up (same signs as MOVE_VEL below);
+                    # no deadband, the device loop settles on its own
+                    self.ws_client.send_json({
+                        "type": "TRACK_ERR", "id": self.vel_id, "dx": dx, "dy": dy,
+                        "w": w, "h": h, "fov_h": CAM_FOV_H, "fov_v": CAM_FOV_V, "t": frame_us
+                    }, log=False)
+
                 if abs(dx) < STEP_RADIUS and abs(dy) < STEP_RADIUS:
                     direction = "Centered ✅"
-                elif abs(dx) > abs(dy):
-                    pan_dir = "LEFT" if dx < 0 else "RIGHT"
-                    direction = f"⬅ Move LEFT" if dx < 0 else "➡ Move RIGHT"
                 else:
-                    tilt_dir = "DOWN" if dy < 0 else "UP"
-                    direction = f"⬇ Move DOWN" if dy < 0 else "⬆ Move UP"
+                    # proportional: negative pan is LEFT, negative tilt is DOWN
+                    pan_dps = KP * dx if abs(dx) >= STEP_RADIUS else 0.0
+                    tilt_dps = KP * dy if abs(dy) >= STEP_RADIUS else 0.0
+                    direction = f"pan {pan_dps:+.0f} tilt {tilt_dps:+.0f} deg/s"
 
         elif self.last_cx is not None:
             cv2.circle(frame, (self.last_cx, self.last_cy), 6, (255, 255, 0), -1)
@@ -159,18 +181,23 @@ class MainWindow(QWidget):
         cv2.putText(frame, direction, (30,50),
                     cv2.FONT_HERSHEY_SIMPLEX, 0.8, (0,255,255), 2, cv2.LINE_AA)
 
-        # Send MOVE_DIR only if changed
-        if (pan_dir != self.last_pan_dir) or (tilt_dir != self.last_tilt_dir):
+        # Send MOVE_VEL when the velocity changed enough, or to keep it alive.
+        # With ON_DEVICE_LOOP a lost target just stops the TRACK_ERRs and the
+        # ESP32 fades out on its own.
+        now = time.monotonic()
+        changed = self.last_vel is None or max(abs(pan_dps - self.last_vel[0]),
+                                               abs(tilt_dps - self.last_vel[1])) >= VEL_EPS
+        moving = pan_dps != 0.0 or tilt_dps != 0.0
+        if not ON_DEVICE_LOOP and (changed or (moving and now - self.last_vel_sent >= VEL_REFRESH_S)):
             msg = {
-                "type": "MOVE_DIR",
-                "id": uuid.uuid4().hex[:12],
-                "pan_dir": pan_dir,
-                "tilt_dir": tilt_dir,
-                "speed": MOVE_SPEED
+                "type": "MOVE_VEL",
+                "id": self.vel_id,
+                "pan_dps": round(pan_dps, 2),
+                "tilt_dps": round(tilt_dps, 2)
             }
             self.ws_client.send_json(msg)
-            self.last_pan_dir = pan_dir
-            self.last_tilt_dir = tilt_dir
+            self.last_vel = (pan_dps, tilt_dps)
+            self.last_vel_sent = now
 
         # Display frame in QLabel
         rgb_image = cv2.cvtColor(frame, cv2.COLOR_BGR2RGB)
@@ -0,0 +1,36 @@
+/*
+  alloc_count.h
+  - Heap allocation counter for host benchmarks. Include from exactly one
+    translation unit of a benchmark program.
+  - Counts operator new plus malloc/calloc/realloc; the C calls are only
+    seen when linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+    (GNU ld), which the native_bench_* envs pass.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+inline unsigned long gAllocCount = 0;
+
+extern "C" {
+void* __real_malloc(size_t n);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t n);
+
+void* __wrap_malloc(size_t n) { gAllocCount++; return __real_malloc(n); }
+void* __wrap_calloc(size_t n, size_t size) { gAllocCount++; return __real_calloc(n, size); }
+void* __wrap_realloc(void* p, size_t n) { gAllocCount++; return __real_realloc(p, n); }
+}
+
+void* operator new(size_t n) {
+  gAllocCount++;
+  if (void* p = __real_malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
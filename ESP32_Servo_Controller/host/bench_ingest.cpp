@@ -0,0 +1,98 @@
+/*
+  bench_ingest.cpp
+  - Host benchmark for the inbound JSON path of webSocketEvent.
+  - "legacy" is the old ingest (String copy + "[WS RX] " + msg + heap
+    document), "arena" is ingestJSON() from src/main.cpp, "handler" runs the
+    whole path on the same frames: webSocketEvent, the motion task applying
+    the command (motionService) and loop() sending the STATUS it queued.
+  - Serial and the socket are discarded so only the firmware's own work is
+    timed.
+
+  Usage (pio run -e native_bench_ingest):
+    .pio/build/native_bench_ingest/program [iterations]
+*/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WebSocketsClient.h>
+
+#include <chrono>
+#include <vector>
+
+#include "alloc_count.h"
+
+extern WebSocketsClient webSocket;
+void webSocketEvent(WStype_t type, uint8_t* payload, size_t length);
+DeserializationError ingestJSON(const uint8_t* payload, size_t length);
+void motionService(unsigned long now);
+void drainStatus();
+
+// what a 30 Hz tracking session sends
+static const char* kFrames[] = {
+    "{\"type\":\"MOVE_DIR\",\"id\":\"9f86d081884c\",\"pan_dir\":\"LEFT\",\"tilt_dir\":\"NONE\",\"speed\":2}",
+    "{\"type\":\"MOVE_DIR\",\"id\":\"7d865e959b24\",\"pan_dir\":\"NONE\",\"tilt_dir\":\"UP\",\"speed\":2}",
+    "{\"type\":\"STATUS_REQ\",\"id\":\"ef2d127de37b\"}",
+    "{\"type\":\"STOP\",\"id\":\"7d865e959b24\"}",
+};
+static const size_t kFrameCount = sizeof(kFrames) / sizeof(kFrames[0]);
+
+static bool ingestLegacy(uint8_t* payload, size_t length) {
+  (void)length;
+  String msg = String((char*)payload);
+  Serial.println("[WS RX] " + msg);
+
+  StaticJsonDocument<512> doc;
+  DeserializationError err = deserializeJson(doc, msg);
+  return !err;
+}
+
+static bool ingestArena(uint8_t* payload, size_t length) {
+  return !ingestJSON(payload, length);
+}
+
+static bool runHandler(uint8_t* payload, size_t length) {
+  webSocketEvent(WStype_TEXT, payload, length);
+  motionService(millis());
+  drainStatus();
+  return true;
+}
+
+static void discard(WStype_t, const uint8_t*, size_t) {}
+
+static void bench(const char* name, bool (*fn)(uint8_t*, size_t),
+                  std::vector<std::vector<uint8_t>>& frames, unsigned long iterations) {
+  // warm-up so one-time growth (statics) is not charged per message
+  for (auto& f : frames) fn(f.data(), f.size() - 1);
+
+  unsigned long failures = 0;
+  unsigned long allocs0 = gAllocCount;
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++) {
+    auto& f = frames[i % frames.size()];
+    if (!fn(f.data(), f.size() - 1)) failures++;
+  }
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  unsigned long allocs = gAllocCount - allocs0;
+
+  printf("%-8s %12.0f msg/s %8.3f us/msg %8.2f allocs/msg %6lu failed\n", name, iterations / sec,
+         sec * 1e6 / iterations, (double)allocs / iterations, failures);
+}
+
+int main(int argc, char** argv) {
+  unsigned long iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+
+  Serial.setSink(nullptr);
+  webSocket.setSink(discard);
+
+  // the client hands frames over NUL-terminated in a writable buffer
+  std::vector<std::vector<uint8_t>> frames;
+  for (size_t i = 0; i < kFrameCount; i++) {
+    const char* f = kFrames[i];
+    frames.emplace_back(f, f + strlen(f) + 1);
+  }
+
+  printf("%lu iterations over %zu frames\n", iterations, kFrameCount);
+  bench("legacy", ingestLegacy, frames, iterations);
+  bench("arena", ingestArena, frames, iterations);
+  bench("handler", runHandler, frames, iterations);
+  return 0;
+}
@@ -0,0 +1,128 @@
+/*
+  bench_status.cpp
+  - Host microbenchmark for outbound ACK/STATUS frames.
+  - "sendJSON" is the old path (StaticJsonDocument -> String -> sendTXT),
+    "static" is sendAck/sendStatus from src/main.cpp (TxFrame, header in
+    place), "binary" is the same calls for a binary-protocol command.
+  - One op = the ACK + STATUS pair a MOVE produces.
+  - Checks first that JSON STATS with every counter at its maximum still
+    fits the outbound frame (TX_FRAME_BYTES) and prints each uint32 as
+    4294967295; fails otherwise.
+
+  Usage (pio run -e native_bench_status):
+    .pio/build/native_bench_status/program [iterations]
+*/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WebSocketsClient.h>
+
+#include <chrono>
+#include <string>
+
+#include "alloc_count.h"
+#include "bin_proto.h"
+#include "cmd_id.h"
+#include "motion_profile.h"
+
+extern WebSocketsClient webSocket;
+void sendAck(const CmdId &id);
+void sendStatus(const CmdId &id, CmdState state, CmdError error);
+void sendStats(const BinStats &st, bool bin);
+
+extern q16_t currentPan, currentTilt;
+
+// ---------- the pre-TxFrame implementation ----------
+static void legacySendJSON(const JsonDocument &doc) {
+  String out;
+  serializeJson(doc, out);
+  webSocket.sendTXT(out);
+}
+
+static void legacyAck(const String &id) {
+  StaticJsonDocument<128> d;
+  d["type"] = "ACK";
+  d["id"] = id;
+  legacySendJSON(d);
+}
+
+static void legacyStatus(const String &id, const char* state, const char* error) {
+  StaticJsonDocument<256> d;
+  d["type"] = "STATUS";
+  d["id"] = id;
+  d["state"] = state;
+  d["pan"] = q16ToDeg(currentPan);
+  d["tilt"] = q16ToDeg(currentTilt);
+  if (error) d["error"] = error;
+  legacySendJSON(d);
+}
+
+// ---------- capture / discard ----------
+static std::string gLast;
+static size_t gBytes = 0;
+
+static void capture(WStype_t, const uint8_t* payload, size_t length) {
+  gLast.assign((const char*)payload, length);
+}
+
+static void count(WStype_t, const uint8_t*, size_t length) { gBytes += length; }
+
+static void bench(const char* name, void (*op)(const CmdId&), const CmdId& id, unsigned long iterations) {
+  op(id);  // warm-up
+  gBytes = 0;
+  unsigned long allocs0 = gAllocCount;
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++) op(id);
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  unsigned long allocs = gAllocCount - allocs0;
+  printf("%-9s %9.1f ns/op %8.2f allocs/op %6.1f bytes/op\n", name, sec * 1e9 / iterations,
+         (double)allocs / iterations, (double)gBytes / iterations);
+}
+
+static void opLegacy(const CmdId& id) {
+  const String sid(id.c_str());  // the old firmware kept ids as Strings already
+  legacyAck(sid);
+  legacyStatus(sid, "SUCCESS", nullptr);
+}
+
+static void opStatic(const CmdId& id) {
+  sendAck(id);
+  sendStatus(id, ST_SUCCESS, ERR_NONE);
+}
+
+int main(int argc, char** argv) {
+  unsigned long iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 500000;
+  Serial.setSink(nullptr);
+
+  // the two JSON paths must produce identical text
+  const CmdId id = CmdId::text("9f86d081884c");
+  webSocket.setSink(capture);
+  legacyStatus(String(id.c_str()), "CANCELLED", "not_active");
+  std::string before = gLast;
+  sendStatus(id, ST_CANCELLED, ERR_NOT_ACTIVE);
+  const bool match = before == gLast;
+  printf("legacy: %s\nstatic: %s\n%s\n\n", before.c_str(), gLast.c_str(),
+         match ? "outputs match" : "OUTPUTS DIFFER");
+
+  // the widest STATS there can be: every counter at UINT32_MAX
+  BinStats worst;
+  memset(&worst, 0xFF, sizeof(worst));
+  worst.op = BIN_STATS;
+  gLast.clear();
+  sendStats(worst, false);
+  // every uint32 must print as 4294967295, never negative: uptime_ms, rx and
+  // handler_us [avg,max] per type, and the 11 other 32-bit counters
+  size_t maxed = 0;
+  for (size_t at = gLast.find("4294967295"); at != std::string::npos; at = gLast.find("4294967295", at + 1)) maxed++;
+  const size_t wantMaxed = 1 + 3 * MSG_COUNT + 11;
+  const bool statsFit = !gLast.empty() && maxed == wantMaxed && gLast.find('-') == std::string::npos;
+  if (gLast.empty()) printf("worst-case JSON STATS: DROPPED (frame too large)\n\n");
+  else printf("worst-case JSON STATS: %u bytes, %u of %u counters at 4294967295%s\n\n", (unsigned)gLast.size(),
+              (unsigned)maxed, (unsigned)wantMaxed, statsFit ? "" : " - WRONG");
+
+  webSocket.setSink(count);
+  printf("%lu iterations, one op = ACK + STATUS\n", iterations);
+  bench("sendJSON", opLegacy, id, iterations);
+  bench("static", opStatic, id, iterations);
+  bench("binary", opStatic, CmdId::number(4242), iterations);
+  return match && statsFit ? 0 : 1;
+}
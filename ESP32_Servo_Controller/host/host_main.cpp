@@ -0,0 +1,188 @@
+/*
+  host_main.cpp
+  - Entry point for the PlatformIO `native` environment.
+  - Boots the firmware (setup() spawns taskMotion on a host thread), then
+    plays a short command script through webSocketEvent, running loop() in
+    between like the Arduino loop task, and prints every frame the firmware
+    sends back.
+  - Plays the server side of the clock sync too: SYNC_REQs are answered
+    with a server clock SERVER_CLOCK_OFFSET_US ahead of the ESP32's.
+  - Run: pio run -e native && .pio/build/native/program
+*/
+#include <Arduino.h>
+#include <WebSocketsClient.h>
+
+#include <esp_timer.h>
+
+#include <string>
+
+#include "bin_proto.h"
+
+extern WebSocketsClient webSocket;
+void setup();
+void loop();
+
+const int64_t SERVER_CLOCK_OFFSET_US = 1000000000LL;
+static int64_t serverNow() { return esp_timer_get_time() + SERVER_CLOCK_OFFSET_US; }
+
+// SYNC answers are delivered from run(), not from inside the send
+static std::string syncReply;
+
+static void sink(WStype_t type, const uint8_t* payload, size_t length) {
+  if (type != WStype_TEXT) {
+    printf("[TX] <%u byte binary frame>\n", (unsigned)length);
+    return;
+  }
+  std::string text((const char*)payload, length);
+  unsigned long seq;
+  long long t;
+  if (sscanf(text.c_str(), "{\"type\":\"SYNC_REQ\",\"seq\":%lu,\"t\":%lld", &seq, &t) == 2) {
+    long long now = serverNow();
+    char buf[160];
+    snprintf(buf, sizeof(buf), "{\"type\":\"SYNC\",\"seq\":%lu,\"t\":%lld,\"rx_us\":%lld,\"tx_us\":%lld}",
+             seq, t, now, now + 20);
+    syncReply = buf;
+    return;  // every 250 ms; keep the transcript readable
+  }
+  printf("[TX] %s\n", text.c_str());
+}
+
+// loop() for about `ms` milliseconds
+static void run(unsigned long ms) {
+  unsigned long start = millis();
+  while (millis() - start < ms) {
+    loop();
+    if (!syncReply.empty()) {
+      std::string reply;
+      reply.swap(syncReply);
+      webSocket.deliverTXT(reply.c_str());
+    }
+  }
+}
+
+static void rx(const char* text) {
+  printf("[RX] %s\n", text);
+  webSocket.deliverTXT(text);
+}
+
+// a JSON TRAJECTORY of `n` points, a zigzag 2 ms apart; the frame itself
+// is too long for the transcript
+static void rxTrajectory(const char* id, int n) {
+  std::string text = std::string("{\"type\":\"TRAJECTORY\",\"id\":\"") + id + "\",\"points\":[";
+  char pt[32];
+  for (int i = 0; i < n; i++) {
+    snprintf(pt, sizeof(pt), "%s%.1f,%.1f,2", i ? "," : "", 85 + (i % 20) * 0.5, 90 + (i / 20) * 0.5);
+    text += pt;
+  }
+  text += "]}";
+  printf("[RX] <TRAJECTORY %s: %d points, %u byte JSON frame>\n", id, n, (unsigned)text.size());
+  webSocket.deliverTXT(text.c_str());
+}
+
+static void rxBin(const void* frame, size_t length) {
+  printf("[RX] <%u byte binary frame, op 0x%02x>\n", (unsigned)length, ((const uint8_t*)frame)[0]);
+  webSocket.deliver(WStype_BIN, (const uint8_t*)frame, length);
+}
+
+int main() {
+  setup();
+  webSocket.setSink(sink);
+  webSocket.deliver(WStype_CONNECTED, (const uint8_t*)"/", 1);
+
+  rx("{\"type\":\"MOVE\",\"id\":\"host-1\",\"pan\":100,\"tilt\":80}");
+  run(400);
+  rx("{\"type\":\"STATUS_REQ\",\"id\":\"host-2\"}");
+  run(200);
+  rx("{\"type\":\"MOVE_DIR\",\"id\":\"host-3\",\"pan_dir\":\"LEFT\",\"tilt_dir\":\"UP\",\"speed\":2}");
+  run(150);
+  rx("{\"type\":\"MOVE_VEL\",\"id\":\"host-3\",\"pan_dps\":-40,\"tilt_dps\":25}");
+  run(150);
+  rx("{\"type\":\"STOP\",\"id\":\"host-3\"}");
+  BinMoveVel vel = {BIN_MOVE_VEL, 43, 2500, 0};
+  rxBin(&vel, sizeof(vel));
+  run(100);
+  rx("{\"type\":\"STOP\"}");
+  rx("{\"type\":\"CANCEL\",\"id\":\"nope\"}");
+  run(50);
+  rx("{\"type\":\"TRACK_ERR\",\"id\":\"host-5\",\"dx\":64,\"dy\":-48}");
+  run(100);
+  rx("{\"type\":\"TRACK_ERR\",\"id\":\"host-5\",\"dx\":30,\"dy\":-20}");
+  run(400);   // frames stop: hold, fade, TIMEOUT
+
+  // a square in one message, progress every 100 ms; then a binary upload
+  // that claims more points than it carries
+  rx("{\"type\":\"TRAJECTORY\",\"id\":\"host-6\",\"report_ms\":100,"
+     "\"points\":[100,90,150, 100,100,150, 90,100,150, 90,90,150]}");
+  run(700);
+  struct {
+    BinTrajHdr h;
+    BinTrajPoint p[1];
+  } __attribute__((packed)) traj = {{BIN_TRAJECTORY, 44, 5, 0}, {{9000, 9000, 100}}};
+  rxBin(&traj, sizeof(traj));
+  run(10);
+
+  // the longest JSON upload runs; one past what the parse arena holds is
+  // still refused by id
+  rxTrajectory("host-11", 256);
+  run(700);
+  rxTrajectory("host-12", 400);
+  run(10);
+
+  // coalesce: three targets back to back, no ACKs; core1 follows the last
+  rx("{\"type\":\"COALESCE\",\"report_ms\":100}");
+  rx("{\"type\":\"MOVE\",\"id\":\"f-1\",\"pan\":95,\"tilt\":95}");
+  rx("{\"type\":\"MOVE\",\"id\":\"f-2\",\"pan\":96,\"tilt\":94}");
+  rx("{\"type\":\"MOVE\",\"id\":\"f-3\",\"pan\":97,\"tilt\":93}");
+  run(600);
+  rx("{\"type\":\"COALESCE\",\"on\":false}");
+
+  BinMove move = {BIN_MOVE, 42, 9000, 9000};
+  rxBin(&move, sizeof(move));
+  run(300);
+  uint8_t req = BIN_STATUS_REQ;
+  rxBin(&req, 1);
+  run(50);
+  rx("{\"type\":\"PING\",\"seq\":1,\"t\":1700000000000000}");
+  BinPing ping = {BIN_PING, 2, 1700000000000123ull};
+  rxBin(&ping, sizeof(ping));
+  run(10);
+
+  // scheduled MOVE, 300 ms out in server time. STATUS_REQ still says IDLE
+  // (it reports only the active command); the ACK shows it was accepted,
+  // the motion log when it starts
+  char sched[128];
+  snprintf(sched, sizeof(sched), "{\"type\":\"MOVE\",\"id\":\"host-4\",\"pan\":95,\"tilt\":95,\"execute_at\":%lld}",
+           (long long)serverNow() + 300000);
+  rx(sched);
+  run(100);
+  rx("{\"type\":\"STATUS_REQ\"}");
+  run(500);
+
+  // priorities: an urgent MOVE runs, a normal one waits for it; one with a
+  // deadline 50 ms out goes ahead of that (EDF) but is still waiting then,
+  // so it is EXPIRED and never moves
+  rx("{\"type\":\"MOVE\",\"id\":\"host-7\",\"pan\":80,\"tilt\":80,\"priority\":3}");
+  rx("{\"type\":\"MOVE\",\"id\":\"host-8\",\"pan\":90,\"tilt\":90}");
+  snprintf(sched, sizeof(sched), "{\"type\":\"MOVE\",\"id\":\"host-9\",\"pan\":100,\"tilt\":100,\"deadline\":%lld}",
+           (long long)serverNow() + 50000);
+  rx(sched);
+  run(900);
+
+  // a MOVE_DIR on a 150 ms lease: renewed twice, then the keepalives stop
+  // and it brakes to a stop on its own (TIMEOUT), no STOP needed
+  rx("{\"type\":\"MOVE_DIR\",\"id\":\"host-10\",\"pan_dir\":\"RIGHT\",\"speed\":1,\"lease_ms\":150}");
+  run(100);
+  rx("{\"type\":\"KEEPALIVE\",\"id\":\"host-10\"}");
+  run(100);
+  rx("{\"type\":\"KEEPALIVE\",\"id\":\"host-10\"}");
+  run(400);
+
+  rx("{\"type\":\"TRACE_DUMP\"}");
+  run(10);
+  rx("{\"type\":\"STATS\"}");
+  run(10);
+
+  fflush(stdout);
+  // taskMotion never returns; leave without running static destructors under it
+  _Exit(0);
+}
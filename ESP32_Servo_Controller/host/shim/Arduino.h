@@ -0,0 +1,107 @@
+/*
+  Arduino.h (host shim)
+  - The slice of the Arduino-ESP32 core + FreeRTOS that the turret firmware
+    touches, implemented on top of the C++ standard library so src/main.cpp
+    builds and runs under the PlatformIO `native` environment.
+  - Tasks are std::threads; noInterrupts()/interrupts() take one global
+    recursive lock, i.e. they serialize like a single-core part would.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <type_traits>
+
+#include "WString.h"
+
+// ---------- time ----------
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// host-only: switch millis()/micros() to a clock that only moves when
+// advanced; delay()/vTaskDelay() then advance it instead of sleeping.
+void hostUseVirtualClock(unsigned long long startUs = 0);
+void hostAdvanceMicros(unsigned long long us);
+
+// ---------- interrupts ----------
+void noInterrupts();
+void interrupts();
+
+// ---------- helpers ----------
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+template <typename T, typename U>
+constexpr typename std::common_type<T, U>::type min(T a, U b) { return (b < a) ? b : a; }
+template <typename T, typename U>
+constexpr typename std::common_type<T, U>::type max(T a, U b) { return (a < b) ? b : a; }
+
+using std::abs;
+using std::round;
+
+// ---------- FreeRTOS ----------
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xffffffffUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdPASS 1
+#define pdTRUE 1
+#define pdFALSE 0
+
+enum eNotifyAction { eNoAction, eSetBits, eIncrement, eSetValueWithOverwrite, eSetValueWithoutOverwrite };
+
+void vTaskDelay(TickType_t ticks);
+BaseType_t xPortGetCoreID();
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                                   void* arg, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void vTaskDelete(TaskHandle_t task);  // host: only nullptr (self), parks the thread
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);  // host: always 0
+
+// direct-to-task notifications (one slot per task, as on the ESP32)
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t ticks);
+
+// ---------- Serial ----------
+class HardwareSerial {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  // host-only: nullptr discards output (benchmarks), default is stdout
+  void setSink(FILE* f) { sink_ = f; }
+
+  size_t write(const uint8_t* buf, size_t n);
+  size_t print(const char* s);
+  size_t print(const String& s) { return print(s.c_str()); }
+  size_t println(const char* s = "");
+  size_t println(const String& s) { return println(s.c_str()); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  FILE* sink_ = stdout;
+};
+
+extern HardwareSerial Serial;
+
+// ---------- ESP ----------
+// heap figures are not tracked on the host; both report 0
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 0; }
+  uint32_t getMinFreeHeap() { return 0; }
+};
+
+extern EspClass ESP;
@@ -0,0 +1,41 @@
+/*
+  ESP32Servo.h (host shim)
+  - Remembers the last commanded pulse width per servo instead of driving
+    PWM. write(degrees) maps onto the attach() range like the library.
+  - An optional write hook sees every write, in microseconds (trajectory
+    capture).
+*/
+#pragma once
+
+#include <Arduino.h>
+
+class ESP32PWM {
+public:
+  static void allocateTimer(int timer) { (void)timer; }
+};
+
+class Servo {
+public:
+  typedef void (*WriteHook)(const Servo& servo, int value);
+
+  int attach(int pin, int minUs = 544, int maxUs = 2400) { pin_ = pin; min_ = minUs; max_ = maxUs; return 1; }
+  void write(int value) {
+    if (value < min_) value = map(constrain(value, 0, 180), 0, 180, min_, max_);   // degrees
+    writeMicroseconds(value);
+  }
+  void writeMicroseconds(int us) {
+    us_ = constrain(us, min_, max_);
+    if (hook_) hook_(*this, us_);
+  }
+  int readMicroseconds() const { return us_; }
+  int pin() const { return pin_; }
+
+  // host-only
+  static void setWriteHook(WriteHook hook) { hook_ = hook; }
+
+private:
+  static inline WriteHook hook_ = nullptr;
+  int pin_ = -1;
+  int min_ = 544, max_ = 2400;
+  int us_ = 1472;
+};
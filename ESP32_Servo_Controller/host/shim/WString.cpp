@@ -0,0 +1,57 @@
+#include "WString.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+
+String::String(const char* s) { concat(s ? s : ""); }
+String::String(const String& s) { concat(s.c_str(), s.len_); }
+String::String(String&& s) noexcept : buf_(s.buf_), len_(s.len_), cap_(s.cap_) {
+  s.buf_ = nullptr; s.len_ = 0; s.cap_ = 0;
+}
+String::String(char c) { concat(&c, 1); }
+String::String(int v) { char b[16]; snprintf(b, sizeof(b), "%d", v); concat(b); }
+String::String(unsigned int v) { char b[16]; snprintf(b, sizeof(b), "%u", v); concat(b); }
+String::String(long v) { char b[24]; snprintf(b, sizeof(b), "%ld", v); concat(b); }
+String::String(unsigned long v) { char b[24]; snprintf(b, sizeof(b), "%lu", v); concat(b); }
+String::~String() { free(buf_); }
+
+String& String::operator=(const String& s) {
+  if (this != &s) { len_ = 0; concat(s.c_str(), s.len_); }
+  return *this;
+}
+
+String& String::operator=(String&& s) noexcept {
+  std::swap(buf_, s.buf_); std::swap(len_, s.len_); std::swap(cap_, s.cap_);
+  return *this;
+}
+
+String& String::operator=(const char* s) {
+  len_ = 0;
+  concat(s ? s : "");
+  return *this;
+}
+
+bool String::reserve(size_t n) {
+  if (buf_ && cap_ >= n) return true;
+  char* nb = (char*)realloc(buf_, n + 1);
+  if (!nb) return false;
+  if (!buf_) nb[0] = 0;
+  buf_ = nb;
+  cap_ = n;
+  return true;
+}
+
+bool String::concat(const char* s, size_t n) {
+  if (!reserve(len_ + n)) return false;
+  memmove(buf_ + len_, s, n);
+  len_ += n;
+  buf_[len_] = 0;
+  return true;
+}
+
+bool String::concat(const char* s) { return concat(s, strlen(s)); }
+
+String operator+(const String& a, const String& b) { String r(a); r.concat(b); return r; }
+String operator+(const char* a, const String& b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, const char* b) { String r(a); r.concat(b); return r; }
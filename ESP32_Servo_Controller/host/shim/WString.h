@@ -0,0 +1,52 @@
+/*
+  WString.h (host shim)
+  - Heap-backed Arduino String, enough of the API for src/main.cpp and
+    ArduinoJson's String adapter.
+  - Storage goes through malloc/realloc like the ESP32 core, so host
+    allocation counters see the same churn the firmware does.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+class String {
+public:
+  String(const char* s = "");
+  String(const String& s);
+  String(String&& s) noexcept;
+  explicit String(char c);
+  explicit String(int v);
+  explicit String(unsigned int v);
+  explicit String(long v);
+  explicit String(unsigned long v);
+  ~String();
+
+  String& operator=(const String& s);
+  String& operator=(String&& s) noexcept;
+  String& operator=(const char* s);
+
+  bool concat(const char* s);
+  bool concat(const char* s, size_t n);
+  bool concat(const String& s) { return concat(s.buf_, s.len_); }
+  String& operator+=(const String& s) { concat(s); return *this; }
+  String& operator+=(const char* s) { concat(s); return *this; }
+
+  const char* c_str() const { return buf_ ? buf_ : ""; }
+  unsigned int length() const { return (unsigned int)len_; }
+  bool reserve(size_t n);
+
+  bool operator==(const String& s) const { return len_ == s.len_ && strcmp(c_str(), s.c_str()) == 0; }
+  bool operator==(const char* s) const { return strcmp(c_str(), s ? s : "") == 0; }
+  bool operator!=(const String& s) const { return !(*this == s); }
+  bool operator!=(const char* s) const { return !(*this == s); }
+
+private:
+  char* buf_ = nullptr;
+  size_t len_ = 0;
+  size_t cap_ = 0;
+};
+
+String operator+(const String& a, const String& b);
+String operator+(const char* a, const String& b);
+String operator+(const String& a, const char* b);
@@ -0,0 +1,59 @@
+/*
+  WebSocketsClient.h (host shim)
+  - No socket: inbound frames are injected with deliver(), outbound frames
+    go to a sink callback (default prints them as "[TX] ...").
+  - Like the ESP32 build of the library, a send without headerToPayload
+    mallocs a header+payload copy, so host allocation counts match.
+*/
+#pragma once
+
+#include <Arduino.h>
+
+#define WEBSOCKETS_MAX_HEADER_SIZE (14)
+
+typedef enum {
+  WStype_ERROR,
+  WStype_DISCONNECTED,
+  WStype_CONNECTED,
+  WStype_TEXT,
+  WStype_BIN,
+  WStype_FRAGMENT_TEXT_START,
+  WStype_FRAGMENT_BIN_START,
+  WStype_FRAGMENT,
+  WStype_FRAGMENT_FIN,
+  WStype_PING,
+  WStype_PONG,
+} WStype_t;
+
+class WebSocketsClient {
+public:
+  typedef void (*WebSocketClientEvent)(WStype_t type, uint8_t* payload, size_t length);
+  typedef void (*HostSink)(WStype_t type, const uint8_t* payload, size_t length);
+
+  void begin(const char* host, uint16_t port, const char* url = "/", const char* protocol = "arduino");
+  void onEvent(WebSocketClientEvent cb) { event_ = cb; }
+  void setReconnectInterval(unsigned long ms) { (void)ms; }
+  void enableHeartbeat(uint32_t pingMs, uint32_t pongMs, uint8_t failures) { (void)pingMs; (void)pongMs; (void)failures; }
+  void loop() {}
+
+  // headerToPayload: payload has WEBSOCKETS_MAX_HEADER_SIZE free bytes in front of it
+  bool sendTXT(uint8_t* payload, size_t length = 0, bool headerToPayload = false);
+  bool sendTXT(char* payload, size_t length = 0, bool headerToPayload = false) {
+    return sendTXT((uint8_t*)payload, length, headerToPayload);
+  }
+  bool sendTXT(const char* payload, size_t length = 0) { return sendTXT((char*)payload, length, false); }
+  bool sendTXT(String& payload) { return sendTXT(payload.c_str(), payload.length()); }
+  bool sendBIN(uint8_t* payload, size_t length, bool headerToPayload = false);
+  bool sendBIN(const uint8_t* payload, size_t length) { return sendBIN((uint8_t*)payload, length, false); }
+
+  // host-only
+  void setSink(HostSink sink) { sink_ = sink; }
+  void deliver(WStype_t type, const uint8_t* payload, size_t length);
+  void deliverTXT(const char* text) { deliver(WStype_TEXT, (const uint8_t*)text, strlen(text)); }
+
+private:
+  bool sendFrame(WStype_t type, uint8_t* payload, size_t length, bool headerToPayload);
+
+  WebSocketClientEvent event_ = nullptr;
+  HostSink sink_ = nullptr;
+};
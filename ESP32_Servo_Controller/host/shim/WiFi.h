@@ -0,0 +1,23 @@
+/*
+  WiFi.h (host shim)
+  - Always "connected"; the host build talks to nothing but the shim socket.
+*/
+#pragma once
+
+#include <Arduino.h>
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+
+class IPAddress {
+public:
+  String toString() const { return String("127.0.0.1"); }
+};
+
+class WiFiClass {
+public:
+  void begin(const char* ssid, const char* pass) { (void)ssid; (void)pass; }
+  wl_status_t status() const { return WL_CONNECTED; }
+  IPAddress localIP() const { return IPAddress(); }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,250 @@
+/*
+  host_core.cpp
+  - Implementations behind the host shim headers (Arduino.h, WiFi.h,
+    WebSocketsClient.h).
+*/
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WebSocketsClient.h>
+
+#include <esp_timer.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+// ---------- time ----------
+static const auto kBoot = std::chrono::steady_clock::now();
+static bool gVirtual = false;
+static unsigned long long gVirtualUs = 0;
+
+static unsigned long long nowUs() {
+  if (gVirtual) return gVirtualUs;
+  return (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - kBoot).count();
+}
+
+unsigned long micros() { return (unsigned long)nowUs(); }
+
+unsigned long millis() { return (unsigned long)(nowUs() / 1000ULL); }
+
+void delay(unsigned long ms) {
+  if (gVirtual) gVirtualUs += ms * 1000ULL;
+  else std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void hostUseVirtualClock(unsigned long long startUs) {
+  gVirtual = true;
+  gVirtualUs = startUs;
+}
+
+void hostAdvanceMicros(unsigned long long us) { gVirtualUs += us; }
+
+// ---------- interrupts ----------
+static std::recursive_mutex gIrqLock;
+
+void noInterrupts() { gIrqLock.lock(); }
+void interrupts() { gIrqLock.unlock(); }
+
+// ---------- FreeRTOS ----------
+struct HostTask {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t value = 0;
+  bool pending = false;
+};
+
+static thread_local BaseType_t tCore = 0;
+static thread_local HostTask* tTask = nullptr;
+
+void vTaskDelay(TickType_t ticks) { delay(ticks * portTICK_PERIOD_MS); }
+
+BaseType_t xPortGetCoreID() { return tCore; }
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                                   void* arg, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core) {
+  (void)name; (void)stackDepth; (void)priority;
+  HostTask* task = new HostTask();  // tasks live until exit, like the firmware's
+  std::thread t([fn, arg, core, task]() { tCore = core; tTask = task; fn(arg); });
+  if (handle) *handle = task;
+  t.detach();
+  return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (!tTask) tTask = new HostTask();  // the main thread / loopTask
+  return tTask;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  (void)task;
+  for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  (void)task;
+  return 0;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t handle, uint32_t value, eNotifyAction action) {
+  HostTask* task = (HostTask*)handle;
+  {
+    std::lock_guard<std::mutex> lock(task->m);
+    switch (action) {
+      case eNoAction: break;
+      case eSetBits: task->value |= value; break;
+      case eIncrement: task->value++; break;
+      case eSetValueWithOverwrite: task->value = value; break;
+      case eSetValueWithoutOverwrite:
+        if (task->pending) return pdFALSE;
+        task->value = value;
+        break;
+    }
+    task->pending = true;
+  }
+  task->cv.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t ticks) {
+  HostTask* task = (HostTask*)xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->m);
+  if (!task->pending) task->value &= ~clearOnEntry;
+  auto ready = [task] { return task->pending; };
+  if (ticks == portMAX_DELAY) task->cv.wait(lock, ready);
+  else if (!task->cv.wait_for(lock, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), ready)) return pdFALSE;
+  if (value) *value = task->value;
+  task->value &= ~clearOnExit;
+  task->pending = false;
+  return pdTRUE;
+}
+
+// ---------- esp_timer ----------
+// One host thread per running timer; periods are kept against absolute
+// deadlines, so like esp_timer a late callback does not shift later ones.
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void* arg;
+  std::atomic<bool> running{false};
+  std::atomic<uint64_t> generation{0};
+};
+
+int64_t esp_timer_get_time() { return (int64_t)micros(); }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  if (!args || !args->callback || !out) return ESP_ERR_INVALID_ARG;
+  esp_timer_handle_t t = new esp_timer();
+  t->callback = args->callback;
+  t->arg = args->arg;
+  *out = t;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t periodUs) {
+  if (!t || periodUs == 0) return ESP_ERR_INVALID_ARG;
+  if (t->running.exchange(true)) return ESP_ERR_INVALID_STATE;
+  uint64_t gen = ++t->generation;
+  std::thread([t, periodUs, gen]() {
+    auto next = std::chrono::steady_clock::now();
+    while (t->running && t->generation == gen) {
+      next += std::chrono::microseconds(periodUs);
+      std::this_thread::sleep_until(next);
+      if (t->running && t->generation == gen) t->callback(t->arg);
+    }
+  }).detach();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeoutUs) {
+  if (!t) return ESP_ERR_INVALID_ARG;
+  if (t->running.exchange(true)) return ESP_ERR_INVALID_STATE;
+  uint64_t gen = ++t->generation;
+  std::thread([t, timeoutUs, gen]() {
+    std::this_thread::sleep_for(std::chrono::microseconds(timeoutUs));
+    if (t->running && t->generation == gen) {
+      t->running = false;
+      t->callback(t->arg);
+    }
+  }).detach();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+  if (!t || !t->running.exchange(false)) return ESP_ERR_INVALID_STATE;
+  return ESP_OK;
+}
+
+// ---------- Serial ----------
+size_t HardwareSerial::write(const uint8_t* buf, size_t n) {
+  if (!sink_) return n;
+  return fwrite(buf, 1, n, sink_);
+}
+
+size_t HardwareSerial::print(const char* s) {
+  if (!sink_) return strlen(s);
+  return fputs(s, sink_) < 0 ? 0 : strlen(s);
+}
+
+size_t HardwareSerial::println(const char* s) {
+  size_t n = print(s);
+  return n + print("\n");
+}
+
+size_t HardwareSerial::printf(const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = sink_ ? vfprintf(sink_, fmt, ap) : vsnprintf(nullptr, 0, fmt, ap);
+  va_end(ap);
+  return n < 0 ? 0 : (size_t)n;
+}
+
+// ---------- WebSocketsClient ----------
+static void printSink(WStype_t type, const uint8_t* payload, size_t length) {
+  if (type == WStype_TEXT) printf("[TX] %.*s\n", (int)length, (const char*)payload);
+  else printf("[TX] <%u byte binary frame>\n", (unsigned)length);
+}
+
+void WebSocketsClient::begin(const char* host, uint16_t port, const char* url, const char* protocol) {
+  (void)host; (void)port; (void)url; (void)protocol;
+  if (!sink_) sink_ = printSink;
+}
+
+bool WebSocketsClient::sendFrame(WStype_t type, uint8_t* payload, size_t length, bool headerToPayload) {
+  uint8_t* copy = nullptr;
+  if (!headerToPayload) {
+    // the ESP32 library packs header + payload into one heap buffer here
+    copy = (uint8_t*)malloc(length + WEBSOCKETS_MAX_HEADER_SIZE);
+    if (!copy) return false;
+    memcpy(copy + WEBSOCKETS_MAX_HEADER_SIZE, payload, length);
+    payload = copy + WEBSOCKETS_MAX_HEADER_SIZE;
+  }
+  if (sink_) sink_(type, payload, length);
+  free(copy);
+  return true;
+}
+
+bool WebSocketsClient::sendTXT(uint8_t* payload, size_t length, bool headerToPayload) {
+  if (length == 0) length = strlen((const char*)payload);
+  return sendFrame(WStype_TEXT, payload, length, headerToPayload);
+}
+
+bool WebSocketsClient::sendBIN(uint8_t* payload, size_t length, bool headerToPayload) {
+  return sendFrame(WStype_BIN, payload, length, headerToPayload);
+}
+
+void WebSocketsClient::deliver(WStype_t type, const uint8_t* payload, size_t length) {
+  if (!event_) return;
+  // the real client hands text frames over NUL-terminated in a scratch buffer
+  std::vector<uint8_t> frame(payload, payload + length);
+  frame.push_back(0);
+  event_(type, frame.data(), length);
+}
@@ -0,0 +1,752 @@
+/*
+  sim_motion.cpp
+  - Deterministic virtual-time simulator for the motion core in src/main.cpp.
+  - Replays a scenario of timestamped WebSocket frames and plays the step
+    timer itself: motionService() after every frame (the NOTIFY_CMD wakeup),
+    motionService() + motionStep() every STEP_INTERVAL_US (an ideal,
+    jitter-free esp_timer). Every servoPan/servoTilt write is recorded with
+    its timestamp.
+  - Reports per-command time-to-target, overshoot and path deviation (how
+    far an absolute move strays from the straight start-target line in
+    pan/tilt space, sampled after every step); --sweep repeats the
+    scenario over a grid of step interval x profile shape. MOVEs with
+    "queue" (a waypoint path) are also timed as a whole; --corner-ms
+    sets CORNER_JUMP_US (0 stops at every turn). A TRAJECTORY is timed
+    from its upload to its SUCCESS. A MOVE held back by a higher-priority
+    command is measured from where it actually starts.
+  - --track replaces the scenario with a synthetic camera: a target moving
+    on a Lissajous path, frames at --track-fps whose TRACK_ERR arrives
+    --track-latency ms after capture, stamped with the capture time (the
+    sim answers SYNC_REQ with its own clock). Reports the tracking error:
+    target angle minus servo angle at every step, after the first second.
+    --track-noise adds Gaussian pixel noise to every detection.
+  - --track-abs has the camera send the target as an absolute MOVE per
+    frame instead (a new id each, the way a server-side loop would), with
+    --coalesce turning on the firmware's latest-wins mode for them; the
+    report adds how many frames the ESP32 sent back.
+  - Regression checks: "expect" lines in the scenario state what a command
+    must end with; the sim prints every miss and exits 1. The built-in
+    scenario carries them for every command it sends (profiles, MOVE_VEL,
+    TRACK_ERR, waypoint blending, TRAJECTORY, COALESCE, priorities and
+    deadlines, leases), and --sweep checks them at every grid point.
+    --expect-rms fails a --track run whose tracking error is above it.
+
+  Usage (pio run -e native_sim, binary in .pio/build/native_sim/program):
+    program [--step-interval MS | --step-us US] [--profile trap|scurve]
+            [--pan-limits DPS,DPS2] [--tilt-limits DPS,DPS2] [--timeout MS] [--corner-ms MS]
+            [--sim-ms N] [--csv FILE] [--bin FILE] [--sweep] [--verbose] [--expect-rms DEG]
+            [--track [--track-fps N] [--track-latency MS] [--track-noise PX]
+                     [--track-gains KP,ALPHA,BETA] [--track-abs [--coalesce REPORT_MS]]]
+            [SCENARIO]
+  SCENARIO lines are "<t_ms> <json frame>", '#' starts a comment. Without
+  one the built-in scenario below is used. Expectations:
+    expect <id> <STATE|-> [at PAN,TILT[,TOL]] [moving|still] [in MIN-MAX]
+  STATE is the terminal STATUS ("-": none ever came), `at` the position
+  it reported from (degrees, TOL default 0.01, plus a step's travel when
+  moving), moving/still the speed on the step after it (faster than 1.5
+  steps of acceleration from rest, or not at all), `in` ms from the
+  command's rx to its terminal STATUS.
+
+  Binary trajectory: little-endian TrajRecord {u32 t_us, u8 axis (0 pan,
+  1 tilt), u8 reserved, i16 angle in centidegrees}, 8 bytes each; the CSV
+  has the angle in degrees.
+*/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESP32Servo.h>
+#include <WebSocketsClient.h>
+
+#include "cmd_id.h"
+#include "fw_stats.h"
+#include "motion_profile.h"
+#include "visual_servo.h"
+
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern WebSocketsClient webSocket;
+extern Servo servoPan, servoTilt;
+extern unsigned long STEP_INTERVAL_US;
+extern ProfileShape MOTION_PROFILE;
+extern AxisLimits PAN_LIMITS, TILT_LIMITS;
+extern unsigned long COMMAND_TIMEOUT_MS;
+extern unsigned long CORNER_JUMP_US;
+extern TrackGains TRACK_GAINS;
+extern q16_t currentPan, currentTilt;
+extern bool hasActive;
+extern CmdId activeCmdId;
+extern StatCounter preemptCount, queueHighWater;
+bool writeServos();
+void webSocketEvent(WStype_t type, uint8_t* payload, size_t length);
+void motionService(unsigned long now);
+void motionStep(unsigned long now);
+void drainStatus();
+size_t statusPending();
+void syncService();
+
+struct TrajRecord {
+  uint32_t t_us;
+  uint8_t axis;
+  uint8_t reserved;
+  int16_t value;
+};
+static_assert(sizeof(TrajRecord) == 8, "TrajRecord must stay packed");
+
+struct Event {
+  unsigned long t_ms;
+  std::string frame;
+};
+
+struct CmdTrack {
+  std::string id;
+  bool absolute;
+  bool queued;           // MOVE with "queue": starts where the MOVE before it ends
+  bool traj;             // TRAJECTORY
+  bool started;          // core1 has made it the active command
+  bool coalesced;        // sent in COALESCE mode: a target that may be replaced
+  unsigned long rxMs;
+  int startPan, startTilt;     // centidegrees
+  int targetPan, targetTilt;
+  long doneMs;           // -1 while no terminal STATUS
+  std::string state;
+  int overshoot;         // centidegrees past target, worst axis
+  double pathDev;        // degrees off the start-target line, worst step
+  int donePan, doneTilt; // centidegrees, where the terminal STATUS left it
+  double arriveDps;      // speed over the step that ended it
+  double exitDps;        // speed over the step after it; -1 until measured
+};
+
+struct Expect {
+  std::string id;
+  std::string state;     // "-": no terminal STATUS
+  bool at = false;
+  double pan = 0, tilt = 0, tol = 0.01;
+  int motion = 0;        // 1 moving, -1 still, 0 either
+  long minMs = -1, maxMs = -1;
+};
+
+static const char* kDefaultScenario =
+    "0    {\"type\":\"MOVE\",\"id\":\"slew-r\",\"pan\":180,\"tilt\":90}\n"
+    "4500 {\"type\":\"MOVE\",\"id\":\"slew-l\",\"pan\":0,\"tilt\":160}\n"
+    "9000 {\"type\":\"MOVE\",\"id\":\"small\",\"pan\":10,\"tilt\":150}\n"
+    "9500 {\"type\":\"MOVE\",\"id\":\"center\",\"pan\":90,\"tilt\":90}\n"
+    "11000 {\"type\":\"MOVE\",\"id\":\"timed\",\"pan\":150,\"tilt\":120,\"duration_ms\":2000}\n"
+    "14000 {\"type\":\"MOVE_DIR\",\"id\":\"dir-r\",\"pan_dir\":\"RIGHT\",\"tilt_dir\":\"NONE\",\"speed\":2}\n"
+    "14600 {\"type\":\"STOP\",\"id\":\"dir-r\"}\n"
+    "15000 {\"type\":\"MOVE_DIR\",\"id\":\"dir-hold\",\"pan_dir\":\"LEFT\",\"tilt_dir\":\"UP\",\"speed\":1}\n"
+    "20000 {\"type\":\"MOVE_VEL\",\"id\":\"vel\",\"pan_dps\":80,\"tilt_dps\":-20}\n"
+    "20500 {\"type\":\"MOVE_VEL\",\"id\":\"vel\",\"pan_dps\":-40,\"tilt_dps\":0}\n"
+    "21500 {\"type\":\"STOP\",\"id\":\"vel\"}\n"
+    "23000 {\"type\":\"MOVE\",\"id\":\"wp-1\",\"pan\":40,\"tilt\":80,\"queue\":true}\n"
+    "23000 {\"type\":\"MOVE\",\"id\":\"wp-2\",\"pan\":80,\"tilt\":100,\"queue\":true}\n"
+    "23000 {\"type\":\"MOVE\",\"id\":\"wp-3\",\"pan\":120,\"tilt\":110,\"queue\":true}\n"
+    "23000 {\"type\":\"MOVE\",\"id\":\"wp-4\",\"pan\":150,\"tilt\":90,\"queue\":true}\n"
+    "23000 {\"type\":\"MOVE\",\"id\":\"wp-5\",\"pan\":120,\"tilt\":60,\"queue\":true}\n"
+    "23000 {\"type\":\"MOVE\",\"id\":\"wp-6\",\"pan\":60,\"tilt\":60,\"queue\":true}\n"
+    "27000 {\"type\":\"TRAJECTORY\",\"id\":\"raster\",\"report_ms\":500,\"points\":["
+    "30,70,1000, 150,70,1200, 150,80,200, 30,80,1200, 30,90,200, 150,90,1200, 150,100,200, 30,100,1200]}\n"
+    "34000 {\"type\":\"MOVE\",\"id\":\"urgent\",\"pan\":60,\"tilt\":130,\"priority\":3}\n"
+    "34050 {\"type\":\"MOVE_DIR\",\"id\":\"nudge\",\"pan_dir\":\"RIGHT\",\"tilt_dir\":\"NONE\",\"speed\":1,\"priority\":0}\n"
+    "34100 {\"type\":\"MOVE\",\"id\":\"next\",\"pan\":120,\"tilt\":90}\n"
+    "37000 {\"type\":\"STOP\",\"id\":\"nudge\"}\n"
+    "40000 {\"type\":\"MOVE_DIR\",\"id\":\"lease\",\"pan_dir\":\"LEFT\",\"tilt_dir\":\"NONE\",\"speed\":4,\"lease_ms\":150}\n"
+    "40100 {\"type\":\"KEEPALIVE\",\"id\":\"lease\"}\n"
+    "40200 {\"type\":\"KEEPALIVE\",\"id\":\"lease\"}\n"
+    "40300 {\"type\":\"KEEPALIVE\",\"id\":\"lease\"}\n"
+    "44000 {\"type\":\"TRACK_ERR\",\"id\":\"track\",\"dx\":64,\"dy\":-48}\n"
+    "44033 {\"type\":\"TRACK_ERR\",\"id\":\"track\",\"dx\":40,\"dy\":-30}\n"
+    "44066 {\"type\":\"TRACK_ERR\",\"id\":\"track\",\"dx\":20,\"dy\":-15}\n"
+    "46000 {\"type\":\"COALESCE\",\"report_ms\":100}\n"
+    "46000 {\"type\":\"MOVE\",\"id\":\"c-1\",\"pan\":100,\"tilt\":100}\n"
+    "46030 {\"type\":\"MOVE\",\"id\":\"c-2\",\"pan\":105,\"tilt\":100}\n"
+    "46060 {\"type\":\"MOVE\",\"id\":\"c-3\",\"pan\":110,\"tilt\":95}\n"
+    "47000 {\"type\":\"COALESCE\",\"on\":false}\n"
+    "48000 {\"type\":\"MOVE\",\"id\":\"hog\",\"pan\":0,\"tilt\":160,\"priority\":3}\n"
+    "48000 {\"type\":\"MOVE\",\"id\":\"late\",\"pan\":180,\"tilt\":90,\"deadline\":48100000}\n"
+    "48000 {\"type\":\"MOVE\",\"id\":\"after\",\"pan\":90,\"tilt\":90}\n"
+    // what each of them must end with
+    "expect slew-r SUCCESS at 180,90 still\n"
+    "expect slew-l SUCCESS at 0,160 still\n"
+    "expect small SUCCESS at 10,150 still\n"
+    "expect center SUCCESS at 90,90 still\n"
+    "expect timed SUCCESS at 150,120 still in 1950-2100\n"
+    "expect dir-r STOPPED\n"
+    "expect dir-hold TIMEOUT in 4000-4100\n"
+    "expect vel STOPPED\n"
+    "expect wp-1 SUCCESS at 40,80,0.5 moving\n"     // blended: passed at speed, not stopped at
+    "expect wp-2 SUCCESS at 80,100,0.5 moving\n"
+    "expect wp-3 SUCCESS at 120,110,0.5 moving\n"
+    "expect wp-4 SUCCESS at 150,90,0.5 moving\n"
+    "expect wp-5 SUCCESS at 120,60,0.5 moving\n"
+    "expect wp-6 SUCCESS at 60,60 still\n"
+    "expect raster SUCCESS at 30,100 still in 6300-6700\n"
+    "expect urgent SUCCESS at 60,130\n"           // "next", then "nudge" start right after
+    "expect nudge STOPPED\n"
+    "expect next SUCCESS at 120,90\n"
+    "expect lease TIMEOUT still in 450-800\n"      // lapsed 150 ms after the last KEEPALIVE, braked
+    "expect track TIMEOUT still\n"
+    "expect c-1 -\n"                                // coalesced: only the latest target reports
+    "expect c-2 -\n"
+    "expect c-3 SUCCESS at 110,95 still\n"
+    "expect hog SUCCESS at 0,160\n"
+    "expect late EXPIRED\n"                         // still waiting behind hog at its deadline
+    "expect after SUCCESS at 90,90 still\n";
+
+// ---------- synthetic camera (--track) ----------
+struct Camera {
+  bool on = false;
+  double fps = 30;
+  double latencyMs = 60;
+  double noisePx = 0;   // std deviation of the detector's position error
+  bool absolute = false;     // MOVE with the target angle instead of TRACK_ERR
+  long coalesceReportMs = -1;   // >= 0: COALESCE on connect
+  unsigned long frames = 0;
+  std::mt19937 rng{1};
+  // the firmware's TRACK_DEFAULT_* frame size and field of view
+  double w = 640, h = 480, fovH = 60, fovV = 45;
+  unsigned long long nextCaptureUs = 0;
+  std::deque<std::pair<unsigned long long, std::string>> inFlight;   // arrival time, frame
+  std::string syncReply;
+  double sumSq = 0, worst = 0;
+  unsigned long samples = 0;
+
+  static double targetPan(double s) { return 90 + 40 * std::sin(2 * M_PI * s / 4.0); }
+  static double targetTilt(double s) { return 100 + 20 * std::sin(2 * M_PI * s / 3.0); }
+
+  unsigned long long nextWakeUs() const {
+    unsigned long long t = nextCaptureUs;
+    if (!inFlight.empty() && inFlight.front().first < t) t = inFlight.front().first;
+    return t;
+  }
+
+  // One frame: where the target is in the image given the servo pose now.
+  // Out of view means no frame.
+  void capture(unsigned long long nowUs) {
+    double s = nowUs / 1e6;
+    double dx = (targetPan(s) - q16ToCdeg(currentPan) / 100.0) * w / fovH;
+    double dy = (targetTilt(s) - q16ToCdeg(currentTilt) / 100.0) * h / fovV;
+    if (noisePx > 0) {
+      std::normal_distribution<double> noise(0, noisePx);
+      dx += noise(rng);
+      dy += noise(rng);
+    }
+    if (std::fabs(dx) <= w / 2 && std::fabs(dy) <= h / 2) {
+      char buf[160];
+      if (absolute) {
+        // pose at capture + error: the target angle, as the server works it out
+        snprintf(buf, sizeof(buf), "{\"type\":\"MOVE\",\"id\":\"cam-%lu\",\"pan\":%.2f,\"tilt\":%.2f}", frames,
+                 q16ToCdeg(currentPan) / 100.0 + dx * fovH / w, q16ToCdeg(currentTilt) / 100.0 + dy * fovV / h);
+      } else {
+        snprintf(buf, sizeof(buf), "{\"type\":\"TRACK_ERR\",\"id\":\"cam\",\"dx\":%ld,\"dy\":%ld,\"t\":%llu}",
+                 lround(dx), lround(dy), nowUs);
+      }
+      inFlight.push_back({nowUs + (unsigned long long)(latencyMs * 1000), buf});
+      frames++;
+    }
+    nextCaptureUs += (unsigned long long)(1e6 / fps);
+  }
+
+  void score(unsigned long long nowUs) {
+    if (nowUs < 1000000) return;
+    double s = nowUs / 1e6;
+    double e = std::hypot(targetPan(s) - q16ToCdeg(currentPan) / 100.0,
+                          targetTilt(s) - q16ToCdeg(currentTilt) / 100.0);
+    sumSq += e * e;
+    if (e > worst) worst = e;
+    samples++;
+  }
+};
+static Camera gCam;
+
+static std::vector<TrajRecord> gTraj;
+static bool gCoalesce = false;            // the scenario has COALESCE on
+static q16_t gPrevPan, gPrevTilt;         // servo angles before the last step
+static std::vector<CmdTrack> gCmds;
+static unsigned long gUplinkFrames = 0;   // everything the ESP32 sent but SYNC_REQ
+
+// the absolute MOVE core1 is running; queued ones wait their turn
+static bool moving(const CmdTrack& c) {
+  return c.absolute && !c.coalesced && c.doneMs < 0 && hasActive && c.id == activeCmdId.c_str();
+}
+
+static CmdTrack* findCmd(const char* id) {
+  for (auto it = gCmds.rbegin(); it != gCmds.rend(); ++it)
+    if (it->id == id) return &*it;
+  return nullptr;
+}
+
+// The pulse width itself is ignored: the angle behind it is recorded.
+static void onWrite(const Servo& s, int us) {
+  (void)us;
+  const bool pan = &s == &servoPan;
+  const int value = q16ToCdeg(pan ? currentPan : currentTilt);
+  TrajRecord r{(uint32_t)micros(), (uint8_t)(pan ? 0 : 1), 0, (int16_t)value};
+  gTraj.push_back(r);
+  // overshoot: distance past target in the direction of travel, while in flight
+  for (auto& c : gCmds) {
+    if (!moving(c)) continue;
+    int start = r.axis == 0 ? c.startPan : c.startTilt;
+    int target = r.axis == 0 ? c.targetPan : c.targetTilt;
+    int past = target >= start ? value - target : target - value;
+    if (past > c.overshoot) c.overshoot = past;
+  }
+}
+
+static void onTx(WStype_t type, const uint8_t* payload, size_t length) {
+  if (type != WStype_TEXT) {
+    gUplinkFrames++;
+    return;
+  }
+  JsonDocument doc;
+  if (deserializeJson(doc, (const char*)payload, length)) return;
+  const char* t = doc["type"] | "";
+  if (strcmp(t, "SYNC_REQ") != 0) gUplinkFrames++;
+  if (strcmp(t, "SYNC_REQ") == 0) {
+    // server clock = sim clock, answered on the next wakeup
+    char buf[160];
+    unsigned long long now = micros();
+    snprintf(buf, sizeof(buf), "{\"type\":\"SYNC\",\"seq\":%lu,\"t\":%llu,\"rx_us\":%llu,\"tx_us\":%llu}",
+             (unsigned long)(doc["seq"] | 0UL), (unsigned long long)(doc["t"] | 0ULL), now, now);
+    gCam.syncReply = buf;
+    return;
+  }
+  const char* state = doc["state"] | "";
+  if (strcmp(t, "STATUS") != 0 || strcmp(state, "MOVING") == 0) return;
+  CmdTrack* c = findCmd(doc["id"] | "");
+  if (c && c->doneMs < 0) {
+    c->doneMs = (long)millis();
+    c->state = state;
+    c->donePan = q16ToCdeg(currentPan);
+    c->doneTilt = q16ToCdeg(currentTilt);
+    c->arriveDps = std::hypot(q16ToCdeg(currentPan) - q16ToCdeg(gPrevPan),
+                              q16ToCdeg(currentTilt) - q16ToCdeg(gPrevTilt)) / 100.0 * 1e6 / STEP_INTERVAL_US;
+  }
+}
+
+// How fast the servos go on the step after a command's terminal STATUS:
+// a blended waypoint is passed at speed, anything else ends at rest.
+static void measureExit() {
+  for (auto& c : gCmds) {
+    if (c.doneMs < 0 || c.exitDps >= 0 || (unsigned long)c.doneMs == millis()) continue;
+    const double d = std::hypot(q16ToCdeg(currentPan) - c.donePan, q16ToCdeg(currentTilt) - c.doneTilt) / 100.0;
+    c.exitDps = d * 1e6 / STEP_INTERVAL_US;
+  }
+}
+
+// A MOVE that waited behind a higher priority starts from wherever the
+// servos are when it gets its turn, not where they were on arrival.
+static void markStarted() {
+  for (auto& c : gCmds) {
+    if (c.started || !c.absolute || c.doneMs >= 0 || !hasActive || c.id != activeCmdId.c_str()) continue;
+    c.started = true;
+    if (c.queued) continue;
+    c.startPan = q16ToCdeg(currentPan);
+    c.startTilt = q16ToCdeg(currentTilt);
+  }
+}
+
+static void trackPath() {
+  for (auto& c : gCmds) {
+    if (!moving(c)) continue;
+    double dx = (c.targetPan - c.startPan) / 100.0, dy = (c.targetTilt - c.startTilt) / 100.0;
+    double len = std::sqrt(dx * dx + dy * dy);
+    if (len == 0) continue;
+    double px = (q16ToCdeg(currentPan) - c.startPan) / 100.0, py = (q16ToCdeg(currentTilt) - c.startTilt) / 100.0;
+    double dev = std::fabs(dx * py - dy * px) / len;
+    if (dev > c.pathDev) c.pathDev = dev;
+  }
+}
+
+static void onRx(const Event& e) {
+  JsonDocument doc;
+  if (!deserializeJson(doc, e.frame.c_str())) {
+    const char* t = doc["type"] | "";
+    if (strcmp(t, "COALESCE") == 0) gCoalesce = doc["on"] | true;
+    bool abs = strcmp(t, "MOVE") == 0;
+    bool traj = strcmp(t, "TRAJECTORY") == 0;
+    bool vel = strcmp(t, "MOVE_DIR") == 0 || strcmp(t, "MOVE_VEL") == 0 || strcmp(t, "TRACK_ERR") == 0;
+    if (abs || traj || (vel && !findCmd(doc["id"] | ""))) {   // same-id MOVE_VEL/TRACK_ERR updates the tracked one
+      CmdTrack c;
+      c.id = doc["id"] | "";
+      c.absolute = abs;
+      c.traj = traj;
+      c.started = false;
+      c.coalesced = abs && gCoalesce;
+      c.rxMs = e.t_ms;
+      c.queued = abs && (doc["queue"] | false);
+      c.startPan = q16ToCdeg(currentPan);
+      c.startTilt = q16ToCdeg(currentTilt);
+      for (auto it = gCmds.rbegin(); c.queued && it != gCmds.rend(); ++it) {
+        if (!it->absolute || it->doneMs >= 0) continue;
+        c.startPan = it->targetPan;
+        c.startTilt = it->targetTilt;
+        break;
+      }
+      c.targetPan = constrain((int)lround((doc["pan"] | c.startPan / 100.0) * 100), 0, 18000);
+      c.targetTilt = constrain((int)lround((doc["tilt"] | c.startTilt / 100.0) * 100), 4500, 18000);
+      c.doneMs = -1;
+      c.overshoot = 0;
+      c.pathDev = 0;
+      c.donePan = c.doneTilt = 0;
+      c.arriveDps = 0;
+      c.exitDps = -1;
+      gCmds.push_back(c);
+    }
+  }
+  webSocket.deliverTXT(e.frame.c_str());
+}
+
+static bool parseExpect(const std::string& line, Expect& e) {
+  std::istringstream in(line);
+  std::string word;
+  in >> word >> e.id >> e.state;
+  if (word != "expect" || e.state.empty()) return false;
+  while (in >> word) {
+    if (word == "moving") e.motion = 1;
+    else if (word == "still") e.motion = -1;
+    else if (word == "at" && in >> word) {
+      e.at = true;
+      if (sscanf(word.c_str(), "%lf,%lf,%lf", &e.pan, &e.tilt, &e.tol) < 2) return false;
+    }
+    else if (word == "in" && in >> word) {
+      if (sscanf(word.c_str(), "%ld-%ld", &e.minMs, &e.maxMs) != 2) return false;
+    }
+    else return false;
+  }
+  return true;
+}
+
+static std::vector<Event> parseScenario(const std::string& text, std::vector<Expect>& expects) {
+  std::vector<Event> events;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) eol = text.size();
+    std::string line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') continue;
+    if (line.compare(first, 6, "expect") == 0) {
+      Expect e;
+      if (parseExpect(line.substr(first), e)) expects.push_back(e);
+      else fprintf(stderr, "bad expect line: %s\n", line.c_str());
+      continue;
+    }
+    char* rest = nullptr;
+    unsigned long t = strtoul(line.c_str() + first, &rest, 10);
+    while (*rest == ' ' || *rest == '\t') rest++;
+    if (*rest) events.push_back({t, rest});
+  }
+  return events;
+}
+
+struct Summary {
+  double avgTimeToTargetMs;
+  unsigned long worstTimeToTargetMs;
+  int worstOvershoot;        // centidegrees
+  double worstPathDev;
+  int success, timeout, other;
+  int waypoints;             // queued MOVEs that reached their target
+  unsigned long pathMs;      // from the first one's rx to the last one's SUCCESS
+};
+
+static Summary runScenario(const std::vector<Event>& events, unsigned long simMs) {
+  hostUseVirtualClock(0);
+  webSocket.onEvent(webSocketEvent);
+  webSocket.setSink(onTx);
+  Servo::setWriteHook(onWrite);
+
+  // taskMotion prologue; connected from the start, so the clock syncs
+  // before any deadline in the scenario
+  writeServos();
+  webSocket.deliver(WStype_CONNECTED, (const uint8_t*)"/", 1);
+  if (gCam.on && gCam.coalesceReportMs >= 0) {
+    char buf[80];
+    snprintf(buf, sizeof(buf), "{\"type\":\"COALESCE\",\"on\":true,\"report_ms\":%ld}", gCam.coalesceReportMs);
+    webSocket.deliverTXT(buf);
+  }
+
+  // jump from wakeup to wakeup: the next frame or the next timer tick
+  const unsigned long long endUs = simMs * 1000ULL;
+  unsigned long long nowUs = 0, nextStepUs = STEP_INTERVAL_US;
+  size_t next = 0;
+  while (true) {
+    unsigned long long frameUs = next < events.size() ? events[next].t_ms * 1000ULL : endUs + 1;
+    unsigned long long camUs = gCam.on ? gCam.nextWakeUs() : endUs + 1;
+    unsigned long long wakeUs = min(min(frameUs, nextStepUs), camUs);
+    if (wakeUs > endUs) break;
+    hostAdvanceMicros(wakeUs - nowUs);
+    nowUs = wakeUs;
+    if (frameUs == wakeUs) {
+      while (next < events.size() && events[next].t_ms * 1000ULL <= nowUs) onRx(events[next++]);
+      motionService(millis());
+    }
+    if (camUs == wakeUs) {
+      if (gCam.nextCaptureUs == nowUs) gCam.capture(nowUs);
+      while (!gCam.inFlight.empty() && gCam.inFlight.front().first <= nowUs) {
+        // a MOVE per frame is scored as tracking, not command by command
+        if (gCam.absolute) webSocket.deliverTXT(gCam.inFlight.front().second.c_str());
+        else onRx(Event{millis(), gCam.inFlight.front().second});
+        gCam.inFlight.pop_front();
+      }
+      motionService(millis());
+    }
+    if (nextStepUs == wakeUs) {
+      motionService(millis());
+      markStarted();
+      gPrevPan = currentPan;
+      gPrevTilt = currentTilt;
+      motionStep(millis());
+      trackPath();
+      measureExit();
+      if (gCam.on) gCam.score(nowUs);
+      nextStepUs += STEP_INTERVAL_US;
+    }
+    // loop() on core0, ideal network
+    while (statusPending()) drainStatus();
+    syncService();
+    if (!gCam.syncReply.empty()) {
+      std::string reply;
+      reply.swap(gCam.syncReply);
+      webSocket.deliverTXT(reply.c_str());
+    }
+  }
+
+  Summary s{0, 0, 0, 0, 0, 0, 0, 0, 0};
+  unsigned long total = 0;
+  long pathStartMs = -1;
+  for (const auto& c : gCmds) {
+    if (c.queued && pathStartMs < 0) pathStartMs = (long)c.rxMs;
+    if (c.queued && c.state == "SUCCESS") {
+      s.waypoints++;
+      s.pathMs = (unsigned long)(c.doneMs - pathStartMs);
+    }
+    if (c.overshoot > s.worstOvershoot) s.worstOvershoot = c.overshoot;
+    if (c.pathDev > s.worstPathDev) s.worstPathDev = c.pathDev;
+    if (c.state == "SUCCESS") {
+      unsigned long ttt = (unsigned long)c.doneMs - c.rxMs;
+      total += ttt;
+      if (ttt > s.worstTimeToTargetMs) s.worstTimeToTargetMs = ttt;
+      s.success++;
+    } else if (c.state == "TIMEOUT") {
+      s.timeout++;
+    } else {
+      s.other++;
+    }
+  }
+  if (s.success) s.avgTimeToTargetMs = (double)total / s.success;
+  return s;
+}
+
+// Misses against the scenario's expectations, each printed; 0 = all met.
+static int checkExpects(const std::vector<Expect>& expects) {
+  // 1.5 steps of the larger acceleration limit: more than a start from
+  // rest reaches on the step after a waypoint it stopped at
+  const double stepS = STEP_INTERVAL_US / 1e6;
+  const double fromRestDps = 1.5 * max(PAN_LIMITS.maxAccDps2, TILT_LIMITS.maxAccDps2) * stepS;
+  int failed = 0;
+  for (const auto& e : expects) {
+    const CmdTrack* c = findCmd(e.id.c_str());
+    // a waypoint passed at speed reports from up to a step beyond it
+    const double tol = e.tol + (c && e.motion == 1 ? max(c->arriveDps, c->exitDps) * stepS : 0);
+    const std::string got = c && !c->state.empty() ? c->state : "-";
+    char why[160] = "";
+    if (!c && e.state != "-") snprintf(why, sizeof(why), "never sent");
+    else if (got != e.state) snprintf(why, sizeof(why), "ended %s", got.c_str());
+    else if (e.state == "-") continue;
+    else if (e.at && (std::fabs(c->donePan / 100.0 - e.pan) > tol || std::fabs(c->doneTilt / 100.0 - e.tilt) > tol))
+      snprintf(why, sizeof(why), "ended at %.2f,%.2f", c->donePan / 100.0, c->doneTilt / 100.0);
+    else if (e.motion == 1 && !(c->exitDps > fromRestDps))
+      snprintf(why, sizeof(why), "stopped there (%.1f deg/s after, from rest gives %.1f)", c->exitDps, fromRestDps);
+    else if (e.motion == -1 && c->exitDps != 0) snprintf(why, sizeof(why), "still moving (%.2f deg/s)", c->exitDps);
+    else if (e.minMs >= 0 && (c->doneMs - (long)c->rxMs < e.minMs || c->doneMs - (long)c->rxMs > e.maxMs))
+      snprintf(why, sizeof(why), "took %ld ms", c->doneMs - (long)c->rxMs);
+    if (!why[0]) continue;
+    printf("expect %s %s: FAILED, %s\n", e.id.c_str(), e.state.c_str(), why);
+    failed++;
+  }
+  return failed;
+}
+
+static bool writeOutputs(const char* csvPath, const char* binPath) {
+  if (csvPath) {
+    FILE* f = fopen(csvPath, "w");
+    if (!f) { perror(csvPath); return false; }
+    fprintf(f, "t_us,axis,value\n");
+    for (const auto& r : gTraj) fprintf(f, "%u,%s,%.2f\n", r.t_us, r.axis ? "tilt" : "pan", r.value / 100.0);
+    fclose(f);
+  }
+  if (binPath) {
+    FILE* f = fopen(binPath, "wb");
+    if (!f) { perror(binPath); return false; }
+    fwrite(gTraj.data(), sizeof(TrajRecord), gTraj.size(), f);
+    fclose(f);
+  }
+  return true;
+}
+
+static void printCommands() {
+  printf("%-10s %-5s %8s %10s %-10s %9s %8s %8s %8s\n", "id", "mode", "rx_ms", "done_ms", "state", "overshoot", "path_dev",
+         "in_dps", "out_dps");
+  for (const auto& c : gCmds) {
+    printf("%-10s %-5s %8lu %10ld %-10s %9.2f %8.2f %8.1f %8.1f\n", c.id.c_str(),
+           c.queued ? "PATH" : c.absolute ? "ABS" : c.traj ? "TRAJ" : "DIR", c.rxMs, c.doneMs,
+           c.state.empty() ? "-" : c.state.c_str(), c.overshoot / 100.0, c.pathDev, c.arriveDps, c.exitDps);
+  }
+}
+
+static const char* profileName(ProfileShape p) { return p == PROFILE_SCURVE ? "scurve" : "trap"; }
+
+static bool parseLimits(const char* s, AxisLimits& out) {
+  unsigned v, a;
+  if (sscanf(s, "%u,%u", &v, &a) != 2 || !v || !a || v > 65535 || a > 65535) return false;
+  out = AxisLimits{(uint16_t)v, (uint16_t)a};
+  return true;
+}
+
+// Failed grid points.
+static int sweep(const std::vector<Event>& events, const std::vector<Expect>& expects, unsigned long simMs) {
+  static const int kIntervals[] = {5, 10, 15, 20, 30};
+  static const ProfileShape kProfiles[] = {PROFILE_TRAPEZOID, PROFILE_SCURVE};
+  int failedPoints = 0;
+  printf("%11s %8s %10s %11s %12s %9s %8s %8s %6s\n", "interval_ms", "profile", "timeout_ms",
+         "avg_ttt_ms", "worst_ttt_ms", "overshoot", "path_dev", "success", "tmout");
+  fflush(stdout);
+  for (int interval : kIntervals) {
+    for (ProfileShape profile : kProfiles) {
+      // each point gets a fresh copy of the firmware globals
+      pid_t pid = fork();
+      if (pid == 0) {
+        STEP_INTERVAL_US = interval * 1000UL;
+        MOTION_PROFILE = profile;
+        Summary s = runScenario(events, simMs);
+        printf("%11d %8s %10lu %11.1f %12lu %9.2f %8.2f %8d %6d\n", interval, profileName(profile), COMMAND_TIMEOUT_MS,
+               s.avgTimeToTargetMs, s.worstTimeToTargetMs, s.worstOvershoot / 100.0, s.worstPathDev, s.success,
+               s.timeout);
+        const int failed = checkExpects(expects);
+        fflush(stdout);
+        _exit(failed ? 1 : 0);
+      }
+      int status = 0;
+      waitpid(pid, &status, 0);
+      if (!WIFEXITED(status) || WEXITSTATUS(status)) failedPoints++;
+    }
+  }
+  return failedPoints;
+}
+
+int main(int argc, char** argv) {
+  unsigned long simMs = 60000;
+  const char* csvPath = nullptr;
+  const char* binPath = nullptr;
+  const char* scenarioPath = nullptr;
+  bool doSweep = false;
+  bool verbose = false;
+  double expectRms = -1;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasVal = i + 1 < argc;
+    if (a == "--step-interval" && hasVal) STEP_INTERVAL_US = strtoul(argv[++i], nullptr, 10) * 1000UL;
+    else if (a == "--step-us" && hasVal) STEP_INTERVAL_US = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--profile" && hasVal) {
+      std::string p = argv[++i];
+      if (p == "trap") MOTION_PROFILE = PROFILE_TRAPEZOID;
+      else if (p == "scurve") MOTION_PROFILE = PROFILE_SCURVE;
+      else { fprintf(stderr, "unknown profile %s\n", p.c_str()); return 2; }
+    }
+    else if (a == "--pan-limits" && hasVal) {
+      if (!parseLimits(argv[++i], PAN_LIMITS)) { fprintf(stderr, "bad --pan-limits\n"); return 2; }
+    }
+    else if (a == "--tilt-limits" && hasVal) {
+      if (!parseLimits(argv[++i], TILT_LIMITS)) { fprintf(stderr, "bad --tilt-limits\n"); return 2; }
+    }
+    else if (a == "--timeout" && hasVal) COMMAND_TIMEOUT_MS = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--corner-ms" && hasVal) CORNER_JUMP_US = min(1000UL, strtoul(argv[++i], nullptr, 10)) * 1000;
+    else if (a == "--sim-ms" && hasVal) simMs = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--csv" && hasVal) csvPath = argv[++i];
+    else if (a == "--bin" && hasVal) binPath = argv[++i];
+    else if (a == "--sweep") doSweep = true;
+    else if (a == "--verbose") verbose = true;
+    else if (a == "--expect-rms" && hasVal) expectRms = atof(argv[++i]);
+    else if (a == "--track") gCam.on = true;
+    else if (a == "--track-fps" && hasVal) gCam.fps = atof(argv[++i]);
+    else if (a == "--track-latency" && hasVal) gCam.latencyMs = atof(argv[++i]);
+    else if (a == "--track-noise" && hasVal) gCam.noisePx = atof(argv[++i]);
+    else if (a == "--track-abs") gCam.absolute = true;
+    else if (a == "--coalesce" && hasVal) gCam.coalesceReportMs = strtol(argv[++i], nullptr, 10);
+    else if (a == "--track-gains" && hasVal) {
+      double kp, alpha, beta;
+      if (sscanf(argv[++i], "%lf,%lf,%lf", &kp, &alpha, &beta) != 3 || kp < 0 || kp > 65 ||
+          alpha < 0 || alpha > 1 || beta < 0 || beta > 2) {
+        fprintf(stderr, "bad --track-gains\n");
+        return 2;
+      }
+      TRACK_GAINS = TrackGains{(uint16_t)lround(kp * 1000), (uint16_t)lround(alpha * 1000),
+                               (uint16_t)lround(beta * 1000)};
+    }
+    else if (a[0] != '-') scenarioPath = argv[i];
+    else { fprintf(stderr, "unknown option %s\n", argv[i]); return 2; }
+  }
+
+  std::string text = gCam.on ? "" : kDefaultScenario;
+  if (scenarioPath) {
+    FILE* f = fopen(scenarioPath, "r");
+    if (!f) { perror(scenarioPath); return 2; }
+    text.clear();
+    char buf[512];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+  }
+  std::vector<Expect> expects;
+  std::vector<Event> events = parseScenario(text, expects);
+  Serial.setSink(verbose ? stdout : nullptr);
+
+  if (doSweep) {
+    const int failedPoints = sweep(events, expects, simMs);
+    if (failedPoints) printf("%d grid points FAILED their expectations\n", failedPoints);
+    return failedPoints ? 1 : 0;
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  Summary s = runScenario(events, simMs);
+  double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+  printCommands();
+  printf("\nSTEP_INTERVAL_US=%lu PROFILE=%s PAN=%u,%u TILT=%u,%u COMMAND_TIMEOUT_MS=%lu\n", STEP_INTERVAL_US,
+         profileName(MOTION_PROFILE), PAN_LIMITS.maxVelDps, PAN_LIMITS.maxAccDps2, TILT_LIMITS.maxVelDps,
+         TILT_LIMITS.maxAccDps2, COMMAND_TIMEOUT_MS);
+  printf("time-to-target avg %.1f ms, worst %lu ms; worst overshoot %.2f deg, path deviation %.2f deg; "
+         "%d success, %d timeout, %d other\n",
+         s.avgTimeToTargetMs, s.worstTimeToTargetMs, s.worstOvershoot / 100.0, s.worstPathDev, s.success, s.timeout,
+         s.other);
+  if (s.waypoints) printf("queued path: %d waypoints in %lu ms\n", s.waypoints, s.pathMs);
+  if (gCam.on && gCam.samples) {
+    printf("tracking %.0f fps, %.0f ms latency: error rms %.2f deg, worst %.2f deg\n", gCam.fps, gCam.latencyMs,
+           std::sqrt(gCam.sumSq / gCam.samples), gCam.worst);
+    printf("%lu camera frames in, %lu frames out, %lu preempted, %u queue high-water\n", gCam.frames,
+           gUplinkFrames, (unsigned long)preemptCount.get(), (unsigned)queueHighWater.get());
+  }
+  printf("simulated %lu ms in %.2f ms wall, %zu servo writes\n", simMs, wallMs, gTraj.size());
+
+  int failed = checkExpects(expects);
+  if (expectRms >= 0) {
+    const double rms = gCam.samples ? std::sqrt(gCam.sumSq / gCam.samples) : INFINITY;
+    if (rms > expectRms) {
+      printf("expect tracking error rms <= %.2f deg: FAILED, %.2f deg\n", expectRms, rms);
+      failed++;
+    }
+  }
+  if (!expects.empty() || expectRms >= 0)
+    printf("%zu expectations, %d failed\n", expects.size() + (expectRms >= 0 ? 1 : 0), failed);
+  if (!writeOutputs(csvPath, binPath)) return 1;
+  return failed ? 1 : 0;
+}
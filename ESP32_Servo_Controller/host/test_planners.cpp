@@ -0,0 +1,391 @@
+/*
+  test_planners.cpp
+  - Host checks for the fixed-point planners the motion task runs on:
+    motion_profile.h (MOVE profiles, Q16 conversions, approachVelocity),
+    path_planner.h (segments, corner and brake speeds, lookahead, PathRun)
+    and visual_servo.h (PoseHistory, the alpha-beta TrackAxis).
+  - Edge cases first: zero-length moves, one axis only, a duration_ms
+    shorter than the limits allow, U-turn corners, full-range segments at
+    the slowest and fastest step rates, where Q16 and 64-bit intermediates
+    are closest to overflowing.
+  - Prints every failed check; exits non-zero if there was one.
+
+  Usage (pio run -e native_test_planners):
+    .pio/build/native_test_planners/program
+*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "motion_profile.h"
+#include "path_planner.h"
+#include "visual_servo.h"
+
+static int checks = 0, failures = 0;
+
+#define CHECK(cond, ...)                                        \
+  do {                                                          \
+    checks++;                                                   \
+    if (!(cond)) {                                              \
+      failures++;                                               \
+      printf("FAILED %s:%d: %s: ", __FILE__, __LINE__, #cond);  \
+      printf(__VA_ARGS__);                                      \
+      printf("\n");                                             \
+    }                                                           \
+  } while (0)
+
+// the firmware's defaults (src/main.cpp)
+static const AxisLimits PAN = {300, 1500};
+static const AxisLimits TILT = {200, 1000};
+static const uint32_t STEP_US = 15000;
+static const uint32_t STEP_RATES[] = {1000, 5000, 15000, 50000, 100000};
+static const q16_t FULL_PAN = 180 * Q16_ONE, FULL_TILT = 135 * Q16_ONE;   // 0..180, 45..180
+
+static int64_t iabs(int64_t v) { return v < 0 ? -v : v; }
+
+// ---------- motion_profile.h ----------
+
+static void testConversions() {
+  for (int cdeg = -32768; cdeg <= 32767; cdeg++) {   // q16ToCdeg is int16_t
+    if (q16ToCdeg(cdegToQ16(cdeg)) != cdeg) {
+      CHECK(false, "cdeg %d round-trips to %d", cdeg, q16ToCdeg(cdegToQ16(cdeg)));
+      break;
+    }
+  }
+  CHECK(q16ToDeg(degToQ16(180)) == 180, "180 deg");
+  CHECK(q16ToDeg(Q16_ONE / 2) == 1, "0.5 deg rounds up, got %d", q16ToDeg(Q16_ONE / 2));
+
+  const uint64_t xs[] = {0, 1, 2, 3, 4, 5, 15, 16, 17, 1ULL << 32, (1ULL << 32) + 1, 1ULL << 62, UINT64_MAX};
+  for (uint64_t x : xs) {
+    const uint64_t r = isqrtCeil(x);
+    // smallest r with r*r >= x (r - 1 squared still below)
+    const bool ceilOk = r == 0 ? x == 0 : (r > 0xFFFFFFFFULL || r * r >= x) && (r - 1) * (r - 1) < x;
+    CHECK(ceilOk, "isqrtCeil(%llu) = %llu", (unsigned long long)x, (unsigned long long)r);
+  }
+}
+
+// Walks a plan step by step: monotonic, inside 0..Q16_ONE, lands exactly
+// on the target, and (unless the ramp was capped) keeps per-step velocity
+// and acceleration within the limits the plan was made for.
+static void walkPlan(const char* what, const ProfilePlan& plan, const AxisMove& m, const AxisLimits& lim,
+                     uint32_t stepUs, bool checkLimits) {
+  const uint32_t n = plan.steps();
+  uint32_t prevF = 0;
+  int64_t prevPos = m.start, prevV = 0, worstV = 0, worstA = 0;
+  bool mono = true;
+  for (uint32_t k = 1; k <= n; k++) {
+    const uint32_t f = plan.fraction(k);
+    if (f < prevF || f > (uint32_t)Q16_ONE) mono = false;
+    prevF = f;
+    const int64_t pos = m.at(plan, k), v = pos - prevPos;
+    if (iabs(v) > worstV) worstV = iabs(v);
+    if (iabs(v - prevV) > worstA) worstA = iabs(v - prevV);
+    prevPos = pos;
+    prevV = v;
+  }
+  CHECK(mono, "%s: fraction() not monotonic in 0..1", what);
+  CHECK(m.at(plan, n) == m.start + m.dist, "%s: ends at %d, not %d", what, m.at(plan, n), m.start + m.dist);
+  CHECK(plan.fraction(n + 1000) == (uint32_t)Q16_ONE, "%s: past the end", what);
+  if (!checkLimits) return;
+  // rounding: the fraction is Q16, so a position can be off by dist / 2^16,
+  // a velocity by twice that and an acceleration by four times
+  const int64_t slack = iabs(m.dist) / Q16_ONE + 2;
+  const int64_t vMax = (int64_t)velPerStep(lim, stepUs);
+  const int64_t aMax = (int64_t)accPerStep(lim, stepUs) * (plan.shape == PROFILE_SCURVE ? 3 : 2) / 2;
+  CHECK(worstV <= vMax + 2 * slack, "%s: %lld per step over the velocity limit %lld", what, (long long)worstV,
+        (long long)vMax);
+  CHECK(worstA <= aMax + 4 * slack, "%s: %lld per step^2 over the acceleration limit %lld", what,
+        (long long)worstA, (long long)aMax);
+}
+
+static ProfilePlan plan2(q16_t dPan, q16_t dTilt, ProfileShape shape, uint32_t stepUs, uint32_t minSteps = 0) {
+  ProfileNeed need;
+  need.add(dPan, PAN, shape, stepUs);
+  need.add(dTilt, TILT, shape, stepUs);
+  return planProfile(need, shape, minSteps);
+}
+
+static void testProfiles() {
+  const ProfileShape SHAPES[] = {PROFILE_TRAPEZOID, PROFILE_SCURVE};
+  for (ProfileShape shape : SHAPES) {
+    // zero-length: no steps at all, already at the target
+    ProfilePlan z = plan2(0, 0, shape, STEP_US);
+    CHECK(z.steps() == 0, "zero-length move has %u steps", z.steps());
+    CHECK(z.fraction(0) == (uint32_t)Q16_ONE, "zero-length move: fraction(0) = %u", z.fraction(0));
+    ProfilePlan zd = plan2(0, 0, shape, STEP_US, 200);
+    CHECK(zd.steps() == 0, "zero-length move with a duration has %u steps", zd.steps());
+
+    for (uint32_t stepUs : STEP_RATES) {
+      char what[96];
+      // one axis only: the other one's need is empty and must not matter
+      ProfilePlan p = plan2(90 * Q16_ONE, 0, shape, stepUs);
+      ProfileNeed panOnly;
+      panOnly.add(90 * Q16_ONE, PAN, shape, stepUs);
+      ProfilePlan q = planProfile(panOnly, shape);
+      CHECK(p.ramp == q.ramp && p.cruise == q.cruise, "pan-only plan differs with a zero tilt axis");
+      snprintf(what, sizeof(what), "pan-only 90 deg, %s, %u us", shape == PROFILE_SCURVE ? "scurve" : "trap", stepUs);
+      walkPlan(what, p, AxisMove{0, 90 * Q16_ONE}, PAN, stepUs, true);
+      walkPlan(what, p, AxisMove{45 * Q16_ONE, 0}, TILT, stepUs, true);   // the idle axis stays put
+
+      // full range on both axes, the largest distance a MOVE can ask for
+      ProfilePlan full = plan2(-FULL_PAN, FULL_TILT, shape, stepUs);
+      snprintf(what, sizeof(what), "full range, %s, %u us", shape == PROFILE_SCURVE ? "scurve" : "trap", stepUs);
+      walkPlan(what, full, AxisMove{FULL_PAN, -FULL_PAN}, PAN, stepUs, true);
+      walkPlan(what, full, AxisMove{45 * Q16_ONE, FULL_TILT}, TILT, stepUs, true);
+
+      // duration_ms shorter than the limits allow: the limits win
+      ProfilePlan rushed = plan2(-FULL_PAN, FULL_TILT, shape, stepUs, 1);
+      CHECK(rushed.ramp == full.ramp && rushed.cruise == full.cruise,
+            "%s: a 1-step duration changed the plan (%u steps, was %u)", what, rushed.steps(), full.steps());
+
+      // a longer duration stretches it, no shorter ramp
+      const uint32_t want = full.steps() * 3;
+      ProfilePlan slow = plan2(-FULL_PAN, FULL_TILT, shape, stepUs, want);
+      CHECK(slow.steps() >= want && slow.steps() <= want + 1, "%s: stretched to %u steps, asked %u", what,
+            slow.steps(), want);
+      CHECK(slow.ramp >= full.ramp, "%s: stretching shortened the ramp", what);
+      walkPlan(what, slow, AxisMove{FULL_PAN, -FULL_PAN}, PAN, stepUs, true);
+    }
+
+    // the longest duration_ms (65535) at 1 ms: ramp capped at PROFILE_MAX_RAMP,
+    // fraction()'s 64-bit numerator at its largest
+    ProfilePlan longest = plan2(FULL_PAN, FULL_TILT, shape, 1000, 65535);
+    CHECK(longest.ramp == PROFILE_MAX_RAMP, "longest duration: ramp %u", longest.ramp);
+    walkPlan("longest duration, 1 ms", longest, AxisMove{0, FULL_PAN}, PAN, 1000, false);
+
+    // a sub-Q16 move: one raw unit still gets a step and lands
+    ProfilePlan tiny = plan2(1, 0, shape, STEP_US);
+    CHECK(tiny.steps() >= 1, "1/65536 deg move has no steps");
+    walkPlan("1/65536 deg", tiny, AxisMove{0, 1}, PAN, STEP_US, false);
+  }
+}
+
+static void testApproach() {
+  CHECK(approachVelocity(0, PAN, STEP_US) == 0, "no error, no velocity");
+  const q16_t vMax = (q16_t)velPerStep(PAN, STEP_US);
+  const q16_t errs[] = {1, -1, Q16_ONE / 10, -Q16_ONE, 5 * Q16_ONE, -FULL_PAN, FULL_PAN};
+  for (q16_t err : errs) {
+    const q16_t v = approachVelocity(err, PAN, STEP_US);
+    CHECK((v > 0) == (err > 0) || v == 0, "approachVelocity(%d) = %d has the wrong sign", err, v);
+    CHECK(iabs(v) <= iabs(err), "approachVelocity(%d) = %d overshoots", err, v);
+    CHECK(iabs(v) <= vMax, "approachVelocity(%d) = %d over the velocity limit", err, v);
+  }
+  CHECK(approachVelocity(FULL_PAN, PAN, STEP_US) == vMax, "far away: full speed");
+}
+
+// ---------- path_planner.h ----------
+
+static PathSeg seg(double fromPan, double fromTilt, double toPan, double toTilt, uint32_t stepUs = STEP_US,
+                   uint32_t minSteps = 0) {
+  PathSeg s;
+  s.init((q16_t)(fromPan * Q16_ONE), (q16_t)(fromTilt * Q16_ONE), (q16_t)(toPan * Q16_ONE),
+         (q16_t)(toTilt * Q16_ONE), PAN, TILT, stepUs, minSteps);
+  return s;
+}
+
+// Drives one segment to its end; checks speed and acceleration stay in
+// bounds, and that it arrives no faster than `exit` allows.
+static uint32_t runSeg(const char* what, const PathSeg& s, int64_t exit, int64_t startV = 0) {
+  PathRun run;
+  run.seg = s;
+  run.exit = exit;
+  run.v = startV;
+  int64_t over = 0, prevV = startV, worstDv = 0;
+  uint32_t steps = 0;
+  bool done = false;
+  while (!done && steps < 1000000) {
+    done = run.step(over);
+    steps++;
+    if (run.v > s.vMax && s.vMax) CHECK(false, "%s: step %u at %lld over vMax %lld", what, steps, (long long)run.v,
+                                        (long long)s.vMax);
+    if (!done && iabs(run.v - prevV) > worstDv) worstDv = iabs(run.v - prevV);
+    prevV = run.v;
+  }
+  CHECK(done, "%s: never reached the end", what);
+  CHECK(run.s == s.len, "%s: stopped at %lld of %lld", what, (long long)run.s, (long long)s.len);
+  CHECK(s.panAt(run.s) == s.startPan + s.distPan && s.tiltAt(run.s) == s.startTilt + s.distTilt,
+        "%s: end point off the target", what);
+  // braking one step of acc at a time, rounding allowed
+  CHECK(worstDv <= s.acc + 2 || !s.len, "%s: velocity jumped %lld in a step, acc %lld", what, (long long)worstDv,
+        (long long)s.acc);
+  CHECK(run.v <= (exit > s.acc ? exit : s.acc) + s.acc + 2 || !s.len, "%s: arrived at %lld for exit %lld", what,
+        (long long)run.v, (long long)exit);
+  return steps;
+}
+
+static void testSegments() {
+  // zero-length: nothing to drive, ends on the first step; a corner into
+  // or out of it is a stop
+  PathSeg z = seg(90, 90, 90, 90);
+  CHECK(z.len == 0 && z.vMax == 0 && z.acc == 0, "zero-length segment len %lld", (long long)z.len);
+  CHECK(runSeg("zero-length", z, 0) == 1, "zero-length segment took more than a step");
+  PathSeg a = seg(0, 90, 90, 90);
+  CHECK(cornerSpeed(a, z, PAN, TILT, STEP_US, 60000) == 0, "corner into a zero-length segment");
+  CHECK(cornerSpeed(z, a, PAN, TILT, STEP_US, 60000) == 0, "corner out of a zero-length segment");
+
+  for (uint32_t stepUs : STEP_RATES) {
+    char what[96];
+    // one axis: the path limits are that axis' own
+    PathSeg p = seg(0, 90, 90, 90, stepUs), t = seg(90, 45, 90, 180, stepUs);
+    CHECK(p.vMax == (int64_t)velPerStep(PAN, stepUs) && p.acc == (int64_t)accPerStep(PAN, stepUs),
+          "pan-only segment limits at %u us", stepUs);
+    CHECK(t.vMax == (int64_t)velPerStep(TILT, stepUs) && t.acc == (int64_t)accPerStep(TILT, stepUs),
+          "tilt-only segment limits at %u us", stepUs);
+    snprintf(what, sizeof(what), "pan-only segment, %u us", stepUs);
+    runSeg(what, p, 0);
+
+    // full-range diagonal: the longest len, largest intermediates
+    PathSeg d = seg(180, 45, 0, 180, stepUs);
+    CHECK(d.len >= (int64_t)(225 * Q16_ONE) && d.len <= (int64_t)(226 * Q16_ONE), "diagonal len %lld",
+          (long long)d.len);
+    snprintf(what, sizeof(what), "full-range diagonal, %u us", stepUs);
+    runSeg(what, d, 0);
+
+    // duration on a segment only lowers the cruise speed, never to 0
+    PathSeg slow = seg(0, 90, 90, 90, stepUs, 100000);
+    CHECK(slow.vMax >= 1 && slow.vMax <= p.vMax, "stretched segment vMax %lld", (long long)slow.vMax);
+    PathSeg rushed = seg(0, 90, 90, 90, stepUs, 1);
+    CHECK(rushed.vMax == p.vMax, "a 1-step duration raised vMax");
+  }
+}
+
+static void testCorners() {
+  const uint32_t JUMP_US = 60000;   // CORNER_JUMP_US
+  for (uint32_t stepUs : STEP_RATES) {
+    const PathSeg out = seg(0, 90, 90, 90, stepUs), back = seg(90, 90, 0, 90, stepUs);
+    const PathSeg on = seg(90, 90, 180, 90, stepUs), up = seg(90, 90, 90, 180, stepUs);
+    const int64_t panJump = (int64_t)velJumpPerStep(PAN, stepUs, JUMP_US);
+    const int64_t tiltJump = (int64_t)velJumpPerStep(TILT, stepUs, JUMP_US);
+
+    // straight on: no corner limit
+    CHECK(cornerSpeed(out, on, PAN, TILT, stepUs, JUMP_US) == out.vMax, "straight on slowed at %u us", stepUs);
+    // U-turn: the velocity swings by 2v, so v = jump / 2
+    const int64_t u = cornerSpeed(out, back, PAN, TILT, stepUs, JUMP_US);
+    CHECK(iabs(u - panJump / 2) <= 1, "U-turn at %u us: %lld, want %lld", stepUs, (long long)u,
+          (long long)(panJump / 2));
+    // 90 degrees pan -> tilt: each axis changes by v
+    const int64_t r = cornerSpeed(out, up, PAN, TILT, stepUs, JUMP_US);
+    const int64_t want = panJump < tiltJump ? panJump : tiltJump;
+    CHECK(iabs(r - want) <= 1, "right angle at %u us: %lld, want %lld", stepUs, (long long)r, (long long)want);
+    // no tolerance: every turn is a stop
+    CHECK(cornerSpeed(out, back, PAN, TILT, stepUs, 0) == 0, "U-turn without tolerance at %u us", stepUs);
+    CHECK(cornerSpeed(out, up, PAN, TILT, stepUs, 0) == 0, "right angle without tolerance at %u us", stepUs);
+
+    // the same corner in deg/s at every step rate (what CORNER_JUMP_US is for)
+    const double dps = (double)u / Q16_ONE * 1e6 / stepUs;
+    CHECK(dps > 44 && dps < 46, "U-turn corner %.2f deg/s at %u us, want 45", dps, stepUs);
+
+    // a U-turn on full-range segments, the largest q in cornerSpeed
+    const PathSeg fa = seg(0, 45, 180, 180, stepUs), fb = seg(180, 180, 0, 45, stepUs);
+    const int64_t fu = cornerSpeed(fa, fb, PAN, TILT, stepUs, JUMP_US);
+    CHECK(fu > 0 && fu <= panJump, "full-range U-turn at %u us: %lld", stepUs, (long long)fu);
+  }
+}
+
+static void testLookahead() {
+  const uint32_t JUMP_US = 60000;
+  const PathSeg a = seg(0, 90, 90, 90), b = seg(90, 90, 180, 90), back = seg(90, 90, 0, 90);
+  // nothing queued behind: stop at the end
+  CHECK(planExitSpeed(&a, 1, PAN, TILT, STEP_US, JUMP_US) == 0, "single segment does not end at rest");
+  // straight on into a segment that ends at rest: as fast as b can brake
+  const PathSeg line[2] = {a, b};
+  const int64_t e = planExitSpeed(line, 2, PAN, TILT, STEP_US, JUMP_US);
+  int64_t want = brakeSpeed(0, b.acc, b.len);
+  if (want > b.vMax) want = b.vMax;
+  CHECK(e == want, "straight exit %lld, want %lld", (long long)e, (long long)want);
+  // U-turn: the corner limits it
+  const PathSeg u[2] = {a, back};
+  CHECK(planExitSpeed(u, 2, PAN, TILT, STEP_US, JUMP_US) ==
+            cornerSpeed(a, back, PAN, TILT, STEP_US, JUMP_US),
+        "U-turn exit is not the corner speed");
+  // brakeSpeed: from the speed it gives, PathRun comes down to exit in dist
+  const int64_t v0 = brakeSpeed(0, b.acc, b.len);
+  runSeg("brake from brakeSpeed", b, 0, v0 < b.vMax ? v0 : b.vMax);
+  CHECK(brakeSpeed(0, b.acc, 0) == 0, "brakeSpeed with no distance");
+  CHECK(brakeSpeed(1000, b.acc, 0) == 1000, "brakeSpeed(exit, 0) is not exit");
+
+  // a full queue (CMD_QUEUE_LEN + 1) of full-range zigzags at the slowest
+  // step: the backward pass stays in range and within the first segment
+  for (uint32_t stepUs : STEP_RATES) {
+    PathSeg zig[17];
+    for (int i = 0; i < 17; i++) zig[i] = i % 2 ? seg(180, 180, 0, 45, stepUs) : seg(0, 45, 180, 180, stepUs);
+    const int64_t x = planExitSpeed(zig, 17, PAN, TILT, stepUs, JUMP_US);
+    CHECK(x >= 0 && x <= zig[0].vMax, "zigzag exit %lld at %u us", (long long)x, stepUs);
+    char what[64];
+    snprintf(what, sizeof(what), "zigzag head, %u us", stepUs);
+    runSeg(what, zig[0], x);
+  }
+}
+
+// ---------- visual_servo.h ----------
+
+static void testPoseHistory() {
+  PoseHistory h;
+  q16_t pan, tilt;
+  CHECK(!h.at(0, pan, tilt), "empty history answered");
+  for (int i = 0; i < 200; i++) h.add(i * 15000LL, i * Q16_ONE, -i * Q16_ONE);   // wraps three times
+  CHECK(h.at(199 * 15000LL + 1, pan, tilt) && pan == 199 * Q16_ONE, "newer than newest: %d", pan);
+  CHECK(h.at(190 * 15000LL + 7500, pan, tilt) && pan == 190 * Q16_ONE + Q16_ONE / 2 && tilt == -pan,
+        "halfway between steps: %d,%d", pan, tilt);
+  const int oldest = 200 - (int)POSE_HISTORY_LEN;
+  CHECK(h.at(0, pan, tilt) && pan == oldest * Q16_ONE, "older than kept: %d, want the oldest %d", pan,
+        oldest * Q16_ONE);
+}
+
+static void testTrackAxis() {
+  const TrackGains g = {15000, 700, 300};   // TRACK_GAINS defaults
+  TrackAxis t;
+  t.update(10 * Q16_ONE, 1000000, g);
+  CHECK(t.angle == 10 * Q16_ONE && t.rate == 0 && t.frameUs == 1000000, "first frame is taken as is");
+  t.update(50 * Q16_ONE, 1000000, g);
+  CHECK(t.angle == 10 * Q16_ONE, "a frame no newer than the last one was used");
+  t.update(50 * Q16_ONE, 900000, g);
+  CHECK(t.angle == 10 * Q16_ONE, "an older frame was used");
+
+  // a steady 20 deg/s target at 30 fps: rate and prediction converge
+  t.reset();
+  const int64_t frameUs = 33333;
+  for (int i = 0; i < 120; i++) {
+    const int64_t us = 1000000 + i * frameUs;
+    t.update((q16_t)(20.0 * Q16_ONE * i * frameUs / 1e6), us, g);
+  }
+  const double rate = (double)t.rate / Q16_ONE;
+  CHECK(rate > 19.8 && rate < 20.2, "steady target: rate %.3f deg/s, want 20", rate);
+  const int64_t ahead = 1000000 + 119 * frameUs + 100000;
+  const double want = 20.0 * (ahead - 1000000) / 1e6;
+  CHECK(iabs(t.predict(ahead) - (q16_t)(want * Q16_ONE)) < Q16_ONE / 20, "prediction 100 ms ahead off by %.3f deg",
+        (double)(t.predict(ahead) - (q16_t)(want * Q16_ONE)) / Q16_ONE);
+  CHECK(t.predict(t.frameUs + 10 * TrackAxis::PREDICT_MAX_US) == t.predict(t.frameUs + TrackAxis::PREDICT_MAX_US),
+        "prediction not capped at PREDICT_MAX_US");
+
+  // frames 1 us apart across the whole range: the rate clamps, no overflow
+  t.reset();
+  t.update(-FULL_PAN, 1000000, g);
+  t.update(FULL_PAN, 1000001, g);
+  CHECK(t.rate == TrackAxis::MAX_RATE, "rate %d not clamped to MAX_RATE", t.rate);
+  t.update(-FULL_PAN, 1000002, g);
+  CHECK(iabs(t.rate) <= TrackAxis::MAX_RATE, "rate %d out of range", t.rate);
+
+  // on target and still: no velocity; off target: toward it
+  t.reset();
+  t.update(30 * Q16_ONE, 1000000, g);
+  CHECK(t.velocity(30 * Q16_ONE, 1000000, g, STEP_US) == 0, "on a still target: velocity %d",
+        t.velocity(30 * Q16_ONE, 1000000, g, STEP_US));
+  CHECK(t.velocity(20 * Q16_ONE, 1000000, g, STEP_US) > 0, "target above, not moving up");
+  CHECK(t.velocity(40 * Q16_ONE, 1000000, g, STEP_US) < 0, "target below, not moving down");
+  // the largest error at the slowest step: stays in q16_t
+  const q16_t v = t.velocity(-FULL_PAN, 1000000, g, 100000);
+  CHECK(v > 0, "full-range error at 100 ms: velocity %d", v);
+}
+
+int main() {
+  testConversions();
+  testProfiles();
+  testApproach();
+  testSegments();
+  testCorners();
+  testLookahead();
+  testPoseHistory();
+  testTrackAxis();
+  printf("%d checks, %d failed\n%s\n", checks, failures, failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,351 @@
+/*
+  bin_proto.h
+  - Compact binary command protocol carried in WStype_BIN frames, next to
+    the JSON one (which stays for debugging).
+  - Little-endian, packed, one message per frame; byte 0 is the opcode.
+  - Angles are centidegrees (int16), ids are u32, MOVE_DIR direction and
+    speed share one byte.
+  - Python side: "Command and Control Server/bin_proto.py".
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ---------- opcodes ----------
+enum BinOp : uint8_t {
+  // server -> ESP32
+  BIN_MOVE       = 0x01,
+  BIN_MOVE_DIR   = 0x02,
+  BIN_STOP       = 0x03,
+  BIN_CANCEL     = 0x04,
+  BIN_STATUS_REQ = 0x05,
+  BIN_TRACE_DUMP = 0x06,
+  BIN_STATS_REQ  = 0x07,
+  BIN_PING       = 0x08,
+  BIN_SYNC       = 0x09,   // answer to our JSON SYNC_REQ
+  BIN_MOVE_VEL   = 0x0A,
+  BIN_TRACK_ERR  = 0x0B,
+  BIN_TRAJECTORY = 0x0C,
+  BIN_COALESCE   = 0x0D,   // session setting, no ACK
+  BIN_KEEPALIVE  = 0x0E,   // renews a MOVE_DIR/MOVE_VEL lease, no ACK
+  // ESP32 -> server
+  BIN_ACK        = 0x81,
+  BIN_STATUS     = 0x82,
+  BIN_TRACE      = 0x83,
+  BIN_STATS      = 0x84,
+  BIN_PONG       = 0x85,
+};
+
+// ---------- STATUS state / error codes (shared with the JSON names) ----------
+enum CmdState : uint8_t {
+  ST_MOVING = 0,
+  ST_SUCCESS,
+  ST_CANCELLED,
+  ST_PREEMPTED,
+  ST_TIMEOUT,
+  ST_STOPPED,
+  ST_ERROR,
+  ST_IDLE,
+  ST_BUSY,
+  ST_EXPIRED,           // its deadline passed before it could start; never ran
+  ST_COUNT
+};
+
+enum CmdError : uint8_t {
+  ERR_NONE = 0,
+  ERR_NOT_ACTIVE,
+  ERR_ID_TOO_LONG,
+  ERR_QUEUE_FULL,
+  ERR_NOT_SYNCED,       // execute_at before the first clock sync
+  ERR_BAD_TIME,         // execute_at too far ahead
+  ERR_BAD_TRAJECTORY,   // TRAJECTORY: no points, too many, or cut short
+  ERR_BUSY,             // TRAJECTORY outranked by the running command (it can't wait)
+  ERR_COUNT
+};
+
+inline const char* stateName(CmdState st) {
+  static const char* const names[ST_COUNT] = {
+    "MOVING", "SUCCESS", "CANCELLED", "PREEMPTED", "TIMEOUT", "STOPPED", "ERROR", "IDLE", "BUSY", "EXPIRED"
+  };
+  return st < ST_COUNT ? names[st] : "ERROR";
+}
+
+inline const char* errorName(CmdError err) {
+  static const char* const names[ERR_COUNT] = { nullptr, "not_active", "id_too_long", "queue_full", "not_synced", "bad_time",
+                                                 "bad_trajectory", "busy" };
+  return err < ERR_COUNT ? names[err] : nullptr;
+}
+
+// Priority class of a motion command. A higher class preempts a lower one
+// and never waits behind it; within a class the earliest deadline goes first.
+enum CmdPriority : uint8_t {
+  PRIO_LOW = 0,
+  PRIO_NORMAL,          // default
+  PRIO_HIGH,
+  PRIO_URGENT,
+  PRIO_COUNT
+};
+
+// ---------- inbound message types (STATS counters) ----------
+enum MsgType : uint8_t {
+  MSG_MOVE = 0,
+  MSG_MOVE_DIR,
+  MSG_STOP,
+  MSG_CANCEL,
+  MSG_STATUS_REQ,
+  MSG_TRACE_DUMP,
+  MSG_STATS,
+  MSG_PING,
+  MSG_SYNC,
+  MSG_MOVE_VEL,
+  MSG_TRACK_ERR,
+  MSG_TRAJECTORY,
+  MSG_COALESCE,
+  MSG_KEEPALIVE,
+  MSG_OTHER,            // unknown JSON type / binary opcode
+  MSG_COUNT,
+  MSG_INVALID = 0xFF    // not parseable: counted as a parse failure
+};
+
+inline const char* msgTypeName(MsgType t) {
+  static const char* const names[MSG_COUNT] = {
+    "MOVE", "MOVE_DIR", "STOP", "CANCEL", "STATUS_REQ", "TRACE_DUMP", "STATS", "PING", "SYNC", "MOVE_VEL", "TRACK_ERR",
+    "TRAJECTORY", "COALESCE", "KEEPALIVE", "OTHER"
+  };
+  return t < MSG_COUNT ? names[t] : "OTHER";
+}
+
+inline MsgType msgTypeFromName(const char* s) {
+  for (uint8_t t = 0; t < MSG_OTHER; t++) {
+    if (strcmp(s, msgTypeName((MsgType)t)) == 0) return (MsgType)t;
+  }
+  return MSG_OTHER;
+}
+
+inline MsgType msgTypeFromOp(uint8_t op) {
+  switch (op) {
+    case BIN_MOVE: return MSG_MOVE;
+    case BIN_MOVE_DIR: return MSG_MOVE_DIR;
+    case BIN_STOP: return MSG_STOP;
+    case BIN_CANCEL: return MSG_CANCEL;
+    case BIN_STATUS_REQ: return MSG_STATUS_REQ;
+    case BIN_TRACE_DUMP: return MSG_TRACE_DUMP;
+    case BIN_STATS_REQ: return MSG_STATS;
+    case BIN_PING: return MSG_PING;
+    case BIN_SYNC: return MSG_SYNC;
+    case BIN_MOVE_VEL: return MSG_MOVE_VEL;
+    case BIN_TRACK_ERR: return MSG_TRACK_ERR;
+    case BIN_TRAJECTORY: return MSG_TRAJECTORY;
+    case BIN_COALESCE: return MSG_COALESCE;
+    case BIN_KEEPALIVE: return MSG_KEEPALIVE;
+    default: return MSG_OTHER;
+  }
+}
+
+// ---------- MOVE_DIR packing: [7:6] pan dir, [5:4] tilt dir, [3:0] speed ----------
+// dir field: 0 = NONE, 1 = LEFT/DOWN (-1), 2 = RIGHT/UP (+1)
+inline int8_t binDirDecode(uint8_t field) { return field == 1 ? -1 : field == 2 ? 1 : 0; }
+inline uint8_t binDirEncode(int8_t dir) { return dir < 0 ? 1 : dir > 0 ? 2 : 0; }
+
+inline uint8_t binPackDir(int8_t panDir, int8_t tiltDir, uint8_t speed) {
+  return (uint8_t)((binDirEncode(panDir) << 6) | (binDirEncode(tiltDir) << 4) | (speed & 0x0F));
+}
+
+// ---------- frames ----------
+#pragma pack(push, 1)
+struct BinMove {          // BIN_MOVE
+  uint8_t op;
+  uint32_t id;
+  int16_t pan_cdeg;
+  int16_t tilt_cdeg;
+};
+
+struct BinMoveDir {       // BIN_MOVE_DIR
+  uint8_t op;
+  uint32_t id;
+  uint8_t dir_speed;
+};
+
+struct BinMoveVel {       // BIN_MOVE_VEL
+  uint8_t op;
+  uint32_t id;
+  int16_t pan_cdps;       // signed, centidegrees per second
+  int16_t tilt_cdps;
+};
+
+struct BinTrackErr {      // BIN_TRACK_ERR
+  uint8_t op;
+  uint32_t id;
+  int16_t dx_px;          // target minus image center; + = pan right / tilt up
+  int16_t dy_px;
+  uint16_t width_px;      // frame size, 0 = default
+  uint16_t height_px;
+  uint16_t fov_h_cdeg;    // camera field of view, 0 = default
+  uint16_t fov_v_cdeg;
+  uint64_t frame_us;      // server clock when the frame was captured, 0 = on arrival
+};
+
+struct BinTrajHdr {       // BIN_TRAJECTORY, followed by `count` BinTrajPoints
+  uint8_t op;
+  uint32_t id;
+  uint16_t count;
+  uint16_t report_ms;     // progress STATUS every this often, 0 = none
+};
+
+struct BinTrajPoint {
+  int16_t pan_cdeg;
+  int16_t tilt_cdeg;
+  uint16_t dt_ms;         // time from the previous point (the first: from the start)
+};
+
+struct BinCoalesce {      // BIN_COALESCE
+  uint8_t op;
+  uint8_t on;             // 1 = latest-wins MOVEs for the rest of this connection
+  uint16_t report_ms;     // position STATUS while following, 0 = none
+};
+
+struct BinSched {         // optional tail of the motion commands, see binSched()
+  uint8_t priority;       // CmdPriority
+  uint64_t deadline_us;   // server clock: start by then or EXPIRED; 0 = none
+};
+
+struct BinIdOnly {        // BIN_STOP (id 0 = whatever is active), BIN_CANCEL, BIN_KEEPALIVE, BIN_ACK
+  uint8_t op;
+  uint32_t id;
+};
+
+struct BinStatus {        // BIN_STATUS
+  uint8_t op;
+  uint32_t id;
+  uint8_t state;          // CmdState
+  uint8_t error;          // CmdError
+  int16_t pan_cdeg;
+  int16_t tilt_cdeg;
+};
+
+struct BinStatusProgress {   // appended to BIN_STATUS while a TRAJECTORY runs
+  uint16_t point;         // points reached so far
+  uint16_t points;
+};
+
+struct BinTraceHdr {      // BIN_TRACE, followed by `count` 32-byte TraceRecords (cmd_trace.h)
+  uint8_t op;
+  uint16_t seq;           // frame number within one dump, from 0
+  uint8_t count;
+  uint8_t last;           // 1 on the final frame of the dump
+};
+
+struct BinPing {          // BIN_PING
+  uint8_t op;
+  uint32_t seq;
+  uint64_t t_us;          // server clock, echoed back untouched
+};
+
+struct BinPong {          // BIN_PONG
+  uint8_t op;
+  uint32_t seq;
+  uint64_t t_us;          // from the PING
+  uint64_t rx_us;         // esp_timer_get_time() when the PING arrived
+  uint64_t tx_us;         // esp_timer_get_time() just before the PONG went out
+};
+
+struct BinSync {          // BIN_SYNC
+  uint8_t op;
+  uint32_t seq;           // from the SYNC_REQ
+  uint64_t t_us;          // our esp_timer time from the SYNC_REQ
+  uint64_t rx_us;         // server clock when the SYNC_REQ arrived
+  uint64_t tx_us;         // server clock just before the SYNC went out
+};
+
+struct BinStats {         // BIN_STATS; arrays are indexed by MsgType
+  uint8_t op;
+  uint32_t uptime_ms;
+  uint32_t rx[MSG_COUNT];
+  uint32_t parse_fail;
+  uint32_t queue_full;          // rejected: cmdRing or MOVE queue full
+  uint16_t ring_hwm;            // cmdRing depth high-water
+  uint16_t queue_hwm;           // queued MOVEs high-water
+  uint32_t preempted;
+  uint32_t cancelled;
+  uint32_t timeouts;
+  uint32_t expired;             // dropped at their deadline without running
+  uint32_t step_overruns;       // step-timer intervals over 1.5 periods
+  uint32_t status_dropped;      // STATUS events lost to a full ring
+  uint32_t coalesced;           // coalesce-mode targets overwritten before core1 took them
+  uint32_t min_free_heap;
+  uint32_t motion_stack_free;   // MotionTask stack high-water mark, bytes left
+  uint32_t handler_avg_us[MSG_COUNT];
+  uint32_t handler_max_us[MSG_COUNT];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(BinMove) == 9, "BinMove layout");
+static_assert(sizeof(BinMoveDir) == 6, "BinMoveDir layout");
+static_assert(sizeof(BinMoveVel) == 9, "BinMoveVel layout");
+static_assert(sizeof(BinTrackErr) == 25, "BinTrackErr layout");
+static_assert(sizeof(BinTrajHdr) == 9, "BinTrajHdr layout");
+static_assert(sizeof(BinTrajPoint) == 6, "BinTrajPoint layout");
+static_assert(sizeof(BinCoalesce) == 4, "BinCoalesce layout");
+static_assert(sizeof(BinSched) == 9, "BinSched layout");
+static_assert(sizeof(BinIdOnly) == 5, "BinIdOnly layout");
+static_assert(sizeof(BinStatus) == 11, "BinStatus layout");
+static_assert(sizeof(BinStatusProgress) == 4, "BinStatusProgress layout");
+static_assert(sizeof(BinTraceHdr) == 5, "BinTraceHdr layout");
+static_assert(sizeof(BinPing) == 13, "BinPing layout");
+static_assert(sizeof(BinPong) == 29, "BinPong layout");
+static_assert(sizeof(BinSync) == 29, "BinSync layout");
+static_assert(sizeof(BinStats) == 233, "BinStats layout");
+
+// Copy a fixed-layout frame out of the payload; false if too short.
+template <typename T>
+inline bool binRead(const uint8_t* payload, size_t length, T& out) {
+  if (length < sizeof(T)) return false;
+  memcpy(&out, payload, sizeof(T));
+  return true;
+}
+
+// MOVE, MOVE_DIR and MOVE_VEL may carry a u64 execute_at (server clock, us) after
+// the fixed part; 0 when absent.
+inline uint64_t binExecuteAt(const uint8_t* payload, size_t length, size_t base) {
+  uint64_t at = 0;
+  if (length >= base + sizeof(at)) memcpy(&at, payload + base, sizeof(at));
+  return at;
+}
+
+// MOVE may carry a u16 duration_ms after execute_at (send execute_at 0 to
+// leave it unscheduled); 0 when absent.
+inline uint16_t binDurationMs(const uint8_t* payload, size_t length, size_t base) {
+  uint16_t ms = 0;
+  if (length >= base + sizeof(uint64_t) + sizeof(ms)) memcpy(&ms, payload + base + sizeof(uint64_t), sizeof(ms));
+  return ms;
+}
+
+// ... and a u8 of BIN_MOVE_* flags after duration_ms; 0 when absent.
+const uint8_t BIN_MOVE_QUEUE = 0x01;   // wait for earlier MOVEs, blend through them
+
+inline uint8_t binMoveFlags(const uint8_t* payload, size_t length, size_t base) {
+  const size_t at = base + sizeof(uint64_t) + sizeof(uint16_t);
+  return length > at ? payload[at] : 0;
+}
+
+// Motion commands may end in a BinSched after everything above (MOVE: after
+// the flags; MOVE_DIR/MOVE_VEL: after execute_at; TRACK_ERR: after the fixed
+// part; TRAJECTORY: after the points). `at` is where it starts; normal
+// priority, no deadline when absent.
+inline BinSched binSched(const uint8_t* payload, size_t length, size_t at) {
+  BinSched s = {PRIO_NORMAL, 0};
+  if (length >= at + sizeof(s)) memcpy(&s, payload + at, sizeof(s));
+  return s;
+}
+
+// MOVE_DIR and MOVE_VEL may carry a u16 lease_ms after their BinSched; 0
+// when absent (no lease, the usual timeout).
+inline uint16_t binLeaseMs(const uint8_t* payload, size_t length, size_t base) {
+  const size_t at = base + sizeof(uint64_t) + sizeof(BinSched);
+  uint16_t ms = 0;
+  if (length >= at + sizeof(ms)) memcpy(&ms, payload + at, sizeof(ms));
+  return ms;
+}
+
@@ -0,0 +1,50 @@
+/*
+  clock_sync.h
+  - Offset between the server's clock and esp_timer_get_time(), from the
+    SYNC_REQ / SYNC exchange (NTP-style, four timestamps per sample).
+  - Keeps the last WINDOW samples and trusts the one with the lowest
+    round trip: least queueing, most likely a symmetric path.
+  - Core0 only (the WebSocket task sends SYNC_REQ and handles SYNC).
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ClockSync {
+  static const size_t WINDOW = 8;
+
+  struct Sample {
+    int64_t offsetUs;   // server clock minus local clock
+    uint32_t rttUs;
+  };
+
+  void reset() { n_ = next_ = best_ = 0; }
+  size_t count() const { return n_; }
+  bool synced() const { return n_ > 0; }
+
+  // t1 local send, t2 server receive, t3 server send, t4 local receive.
+  // Returns false for a sample that can't be right (clock stepped, bad echo).
+  bool add(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+    const int64_t rtt = (t4 - t1) - (t3 - t2);
+    if (t4 < t1 || t3 < t2 || rtt < 0) return false;
+    samples_[next_] = Sample{((t2 - t1) + (t3 - t4)) / 2, (uint32_t)rtt};
+    next_ = (next_ + 1) % WINDOW;
+    if (n_ < WINDOW) n_++;
+    best_ = 0;
+    for (size_t i = 1; i < n_; i++) {
+      if (samples_[i].rttUs < samples_[best_].rttUs) best_ = i;
+    }
+    return true;
+  }
+
+  int64_t offsetUs() const { return samples_[best_].offsetUs; }
+  uint32_t rttUs() const { return samples_[best_].rttUs; }
+
+  int64_t toLocal(int64_t serverUs) const { return serverUs - offsetUs(); }
+  int64_t toServer(int64_t localUs) const { return localUs + offsetUs(); }
+
+private:
+  Sample samples_[WINDOW];
+  size_t n_ = 0, next_ = 0, best_ = 0;
+};
@@ -0,0 +1,50 @@
+/*
+  cmd_id.h
+  - Command id stored inline instead of in an Arduino String: up to
+    CMD_ID_MAX_LEN chars, NUL padded, compared as three 64-bit words.
+  - Copying one is a plain struct copy and comparing two is three integer
+    compares, so they are cheap inside noInterrupts() sections.
+  - Binary-protocol ids (u32) are kept as their decimal text too, so a JSON
+    CANCEL/STOP can name them; `bin` says which format the command used.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const size_t CMD_ID_MAX_LEN = 23;
+
+struct CmdId {
+  uint64_t w[3];   // id text, NUL padded
+  uint32_t num;    // binary-protocol id (bin == true)
+  bool bin;
+
+  const char* c_str() const { return (const char*)w; }
+  bool empty() const { return w[0] == 0; }
+
+  bool operator==(const CmdId& o) const { return w[0] == o.w[0] && w[1] == o.w[1] && w[2] == o.w[2]; }
+  bool operator!=(const CmdId& o) const { return !(*this == o); }
+
+  // JSON id; longer ids are truncated and `fits` is cleared
+  static CmdId text(const char* s, bool* fits = nullptr) {
+    CmdId id = {{0, 0, 0}, 0, false};
+    size_t n = strnlen(s, CMD_ID_MAX_LEN + 1);
+    if (fits) *fits = n <= CMD_ID_MAX_LEN;
+    memcpy(id.w, s, n > CMD_ID_MAX_LEN ? CMD_ID_MAX_LEN : n);
+    return id;
+  }
+
+  // binary id; 0 means "no id"
+  static CmdId number(uint32_t n) {
+    CmdId id = {{0, 0, 0}, n, true};
+    if (n == 0) return id;
+    char tmp[10];
+    size_t i = sizeof(tmp);
+    do { tmp[--i] = (char)('0' + n % 10); n /= 10; } while (n);
+    memcpy(id.w, tmp + i, sizeof(tmp) - i);
+    return id;
+  }
+
+  static CmdId none() { return CmdId{{0, 0, 0}, 0, false}; }
+};
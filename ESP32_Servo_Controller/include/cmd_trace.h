@@ -0,0 +1,60 @@
+/*
+  cmd_trace.h
+  - Per-command latency trace. Six microsecond timestamps are taken along a
+    command's path and travel with it (Cmd -> StatusEvent), so the finished
+    record is written by core0 alone and the ring needs no locking.
+  - TRACE_DUMP streams the ring out as BIN_TRACE frames (bin_proto.h).
+  - Timestamps are the low 32 bits of esp_timer_get_time(); subtract them
+    as uint32_t. 0 means "did not happen" (e.g. no servo write).
+*/
+#pragma once
+
+#include <esp_timer.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cmd_id.h"
+
+struct CmdTimes {
+  uint32_t rx;          // webSocketEvent entry
+  uint32_t parsed;      // JSON / binary frame decoded
+  uint32_t acked;       // ACK handed to the socket
+  uint32_t dequeued;    // taken off cmdRing by taskMotion
+  uint32_t firstWrite;  // first servo write while active
+  uint32_t status;      // terminal STATUS handed to the socket
+};
+
+struct TraceRecord {
+  uint32_t id;          // binary id, or traceTag() of the JSON id text
+  uint8_t op;           // CmdOp
+  uint8_t state;        // terminal CmdState
+  uint8_t error;        // CmdError
+  uint8_t reserved;
+  CmdTimes t;
+};
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord is streamed as-is");
+
+inline uint32_t traceNow() { return (uint32_t)esp_timer_get_time(); }
+
+// binary ids as-is, JSON ids as 32-bit FNV-1a of the text
+inline uint32_t traceTag(const CmdId& id) {
+  if (id.bin) return id.num;
+  uint32_t h = 2166136261u;
+  for (const char* p = id.c_str(); *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+  return h;
+}
+
+// Fixed-size ring that overwrites the oldest record. Single writer.
+template <size_t N>
+class TraceRing {
+public:
+  void add(const TraceRecord& r) { buf_[written_++ % N] = r; }
+  size_t size() const { return written_ < N ? written_ : N; }
+  uint32_t written() const { return written_; }
+  // i = 0 is the oldest record still held
+  const TraceRecord& at(size_t i) const { return buf_[(written_ - size() + i) % N]; }
+
+private:
+  TraceRecord buf_[N];
+  uint32_t written_ = 0;
+};
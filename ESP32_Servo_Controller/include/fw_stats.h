@@ -0,0 +1,39 @@
+/*
+  fw_stats.h
+  - Building blocks for the STATS counters; cheap enough to stay on.
+  - StatCounter: owned by one task, readable from any. Single writer, so a
+    relaxed load + store is enough (a plain 32-bit store on the ESP32), no
+    atomic read-modify-write.
+  - HandlerTiming: count / max / sum of handler run time in microseconds,
+    only ever touched by the WebSocket task.
+*/
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+class StatCounter {
+public:
+  void inc() { add(1); }
+  void add(uint32_t n) { v_.store(v_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+  void raiseTo(uint32_t x) {
+    if (x > v_.load(std::memory_order_relaxed)) v_.store(x, std::memory_order_relaxed);
+  }
+  uint32_t get() const { return v_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint32_t> v_{0};
+};
+
+struct HandlerTiming {
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t sumUs;
+
+  void add(uint32_t us) {
+    count++;
+    sumUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+  uint32_t avgUs() const { return count ? (uint32_t)(sumUs / count) : 0; }
+};
@@ -0,0 +1,75 @@
+/*
+  json_arena.h
+  - ArduinoJson allocator over a fixed static buffer.
+  - Bump allocation; deallocate() only gives back the top block. Call
+    reset() once the document using it has been cleared, so parsing a frame
+    never touches the heap.
+  - Allocations that don't fit return nullptr; ArduinoJson turns that into
+    DeserializationError::NoMemory.
+*/
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+template <size_t N>
+class JsonArena : public ArduinoJson::Allocator {
+public:
+  void reset() { used_ = 0; top_ = nullptr; }
+  size_t used() const { return used_; }
+  size_t highWater() const { return highWater_; }
+
+  void* allocate(size_t size) override {
+    size = alignUp(size);
+    if (used_ + HDR + size > N) return nullptr;
+    uint8_t* block = buf_ + used_;
+    memcpy(block, &size, sizeof(size));
+    used_ += HDR + size;
+    if (used_ > highWater_) highWater_ = used_;
+    top_ = block + HDR;
+    return top_;
+  }
+
+  void deallocate(void* ptr) override {
+    if (ptr && ptr == top_) {
+      used_ = (uint8_t*)ptr - HDR - buf_;
+      top_ = nullptr;
+    }
+  }
+
+  void* reallocate(void* ptr, size_t newSize) override {
+    if (!ptr) return allocate(newSize);
+    newSize = alignUp(newSize);
+    size_t oldSize = blockSize(ptr);
+    if (ptr == top_) {
+      size_t base = (uint8_t*)ptr - buf_;
+      if (base + newSize > N) return nullptr;
+      memcpy((uint8_t*)ptr - HDR, &newSize, sizeof(newSize));
+      used_ = base + newSize;
+      if (used_ > highWater_) highWater_ = used_;
+      return ptr;
+    }
+    if (newSize <= oldSize) return ptr;
+    void* moved = allocate(newSize);
+    if (moved) memcpy(moved, ptr, oldSize);
+    return moved;
+  }
+
+private:
+  static const size_t ALIGN = 8;
+  static const size_t HDR = ALIGN;  // holds the block size
+
+  static size_t alignUp(size_t n) { return (n + ALIGN - 1) & ~(ALIGN - 1); }
+  static size_t blockSize(void* ptr) {
+    size_t n;
+    memcpy(&n, (uint8_t*)ptr - HDR, sizeof(n));
+    return n;
+  }
+
+  alignas(ALIGN) uint8_t buf_[N];
+  size_t used_ = 0;
+  size_t highWater_ = 0;
+  void* top_ = nullptr;
+};
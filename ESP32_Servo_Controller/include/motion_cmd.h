@@ -0,0 +1,65 @@
+/*
+  motion_cmd.h
+  - What core0 hands to the motion task on core1 (Cmd), and the STATUS
+    reports core1 hands back (StatusEvent). Plain data so both can go
+    through SpscRing by value.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#include "bin_proto.h"
+#include "cmd_id.h"
+#include "cmd_trace.h"
+#include "motion_profile.h"
+
+enum CmdOp : uint8_t {
+  OP_MOVE,       // absolute target; preempts, or queues behind earlier MOVEs, or
+                 // (coalesce mode) replaces the target being followed
+  OP_MOVE_DIR,   // directional, takes over immediately
+  OP_STOP,       // empty id: stop whatever is active
+  OP_CANCEL,     // active or queued command
+  OP_MOVE_VEL,   // signed velocity per axis, takes over immediately
+  OP_TRACK_ERR,  // target error from a camera frame, closed loop on core1
+  OP_TRAJECTORY, // waypoint list (points in TrajUpload), takes over immediately
+  OP_KEEPALIVE,  // renews the active velocity command's lease; no ACK, STATUS or trace
+};
+
+struct Cmd {
+  CmdOp op;
+  CmdId id;
+  int16_t pan;       // OP_MOVE, centidegrees
+  int16_t tilt;
+  uint16_t durationMs;  // OP_MOVE: requested duration, 0 = as fast as the limits allow
+  bool queued;       // OP_MOVE: waits for the MOVE before it and blends into it
+  int8_t panDir;     // OP_MOVE_DIR, -1/0/+1
+  int8_t tiltDir;
+  uint8_t speed;     // OP_MOVE_DIR, degrees per step
+  uint8_t priority;  // CmdPriority (motion commands)
+  int16_t panVel;    // OP_MOVE_VEL, centidegrees per second
+  int16_t tiltVel;
+  q16_t panErr;      // OP_TRACK_ERR, degrees off the image center
+  q16_t tiltErr;
+  int64_t frameUs;   // OP_TRACK_ERR capture time as esp_timer time
+  uint16_t points;   // OP_TRAJECTORY: how many are waiting in TrajUpload
+  uint16_t reportMs; // OP_TRAJECTORY / coalesced OP_MOVE: STATUS period, 0 = none
+  uint16_t leaseMs;  // OP_MOVE_DIR/OP_MOVE_VEL: runs this long past the last renewal, 0 = no lease
+  int64_t startUs;   // MOVE/MOVE_DIR execute_at as esp_timer time, 0 = on arrival
+  int64_t deadlineUs;   // start by this esp_timer time or EXPIRED, 0 = none
+  CmdTimes t;        // trace timestamps so far
+  uint32_t latestSeq;   // coalesced MOVEs sent before this one (core1 keeps the order)
+};
+
+struct StatusEvent {
+  CmdId id;
+  CmdState state;
+  CmdError error;
+  int16_t pan;       // position when the event happened, centidegrees
+  int16_t tilt;
+  bool final;        // last event for this command: core0 files its trace
+  bool silent;       // trace only, no STATUS frame (e.g. the command a STOP ended)
+  CmdOp op;
+  CmdTimes t;
+  uint16_t point;    // TRAJECTORY progress: points reached of `points`;
+  uint16_t points;   // 0 = not a progress report
+};
@@ -0,0 +1,174 @@
+/*
+  motion_profile.h
+  - Velocity/acceleration-limited point-to-point profiles for absolute MOVE,
+    trapezoidal or S-curve, all integer math (Q16.16 degrees).
+  - A plan is just the step counts (ramp, cruise, ramp); position at step k
+    is start + dist * fraction(k), in closed form, so nothing accumulates
+    and the last step lands exactly on the target.
+  - S-curve: velocity follows smoothstep (3x^2 - 2x^3) through each ramp,
+    so acceleration starts and ends at zero. Peak acceleration is 1.5x the
+    trapezoid's for the same ramp, and the plan allows for it.
+  - Ramps cover the same distance for both shapes, so the cruise part of
+    fraction() is shared.
+  - Both axes of a MOVE run one plan: each axis adds what it needs to a
+    ProfileNeed and the plan satisfies all of them, so they start and stop
+    together on a straight line in angle space. A requested duration only
+    stretches the plan; the limits always win.
+*/
+#pragma once
+
+#include <stdint.h>
+
+typedef int32_t q16_t;               // degrees, 16.16 fixed point
+const q16_t Q16_ONE = 1 << 16;
+
+inline q16_t degToQ16(int deg) { return (q16_t)deg * Q16_ONE; }
+inline int q16ToDeg(q16_t q) { return (q + Q16_ONE / 2) >> 16; }   // nearest
+inline q16_t cdegToQ16(int cdeg) { return (q16_t)(((int64_t)cdeg * Q16_ONE + (cdeg < 0 ? -50 : 50)) / 100); }
+inline int16_t q16ToCdeg(q16_t q) { return (int16_t)(((int64_t)q * 100 + (q < 0 ? -Q16_ONE / 2 : Q16_ONE / 2)) / Q16_ONE); }
+
+enum ProfileShape : uint8_t {
+  PROFILE_TRAPEZOID = 0,
+  PROFILE_SCURVE,
+};
+
+struct AxisLimits {
+  uint16_t maxVelDps;                // deg/s
+  uint16_t maxAccDps2;               // deg/s^2
+};
+
+const uint16_t PROFILE_MAX_RAMP = 1000;  // steps; keeps fraction() inside 64 bits
+
+inline uint64_t isqrtCeil(uint64_t x) {
+  uint64_t r = 0;
+  for (uint64_t bit = 1ULL << 62; bit; bit >>= 2) {
+    if (x >= r + bit) {
+      x -= r + bit;
+      r = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+  }
+  return x ? r + 1 : r;   // x holds the remainder
+}
+
+struct ProfilePlan {
+  uint16_t ramp;                     // accel steps (decel is the same)
+  uint32_t cruise;                   // constant-velocity steps
+  ProfileShape shape;
+
+  uint32_t steps() const { return 2u * ramp + cruise; }
+
+  // Share of the distance covered after step k, Q16 (0 .. Q16_ONE).
+  uint32_t fraction(uint32_t k) const {
+    const uint32_t n = steps();
+    if (k >= n) return Q16_ONE;
+    const uint64_t na = ramp, span = na + cruise;
+    const bool s = shape == PROFILE_SCURVE;
+    const uint64_t den = s ? 2 * na * na * na * span : 2 * na * span;
+    uint64_t num;
+    if (k <= na) {
+      num = rampArea(k);
+    } else if (k <= na + cruise) {
+      num = (s ? na * na * na : na) * (2 * (uint64_t)k - na);
+    } else {
+      num = den - rampArea(n - k);
+    }
+    return (uint32_t)((num << 16) / den);
+  }
+
+  // numerator of fraction() for k steps into a ramp
+  uint64_t rampArea(uint64_t k) const {
+    if (shape == PROFILE_SCURVE) return 2 * k * k * k * ramp - k * k * k * k;
+    return k * k;
+  }
+};
+
+// Axis limits per step, Q16 degrees (per step, per step^2); at least 1.
+inline uint64_t velPerStep(const AxisLimits &lim, uint32_t stepUs) {
+  uint64_t v = ((uint64_t)lim.maxVelDps * stepUs << 16) / 1000000;
+  return v ? v : 1;
+}
+
+inline uint64_t accPerStep(const AxisLimits &lim, uint32_t stepUs) {
+  uint64_t a = (((uint64_t)lim.maxAccDps2 * stepUs * stepUs / 1000000) << 16) / 1000000;
+  return a ? a : 1;
+}
+
+// What the axes of one move need from their shared plan, with
+// span = ramp + cruise (the distance is covered at peak velocity over span):
+//   span >= |dist| / v                    (velocity limit)
+//   ramp * span >= peak/2 * |dist| / a    (acceleration limit)
+// where peak is 2 for the trapezoid and 3 for the S-curve.
+struct ProfileNeed {
+  uint64_t minSpan = 0;
+  uint64_t minArea = 0;
+
+  void add(q16_t dist, const AxisLimits &lim, ProfileShape shape, uint32_t stepUs) {
+    const uint64_t d = (uint64_t)(dist < 0 ? -(int64_t)dist : dist);
+    if (d == 0) return;
+    const uint64_t v = velPerStep(lim, stepUs);
+    const uint64_t a = accPerStep(lim, stepUs);
+    const uint64_t peak = shape == PROFILE_SCURVE ? 3 : 2;
+    const uint64_t span = (d + v - 1) / v;
+    const uint64_t area = (peak * d + 2 * a - 1) / (2 * a);
+    if (span > minSpan) minSpan = span;
+    if (area > minArea) minArea = area;
+  }
+};
+
+// Shortest plan meeting `need`, stretched to at least minSteps if asked.
+inline ProfilePlan planProfile(const ProfileNeed &need, ProfileShape shape, uint32_t minSteps = 0) {
+  ProfilePlan p = {0, 0, shape};
+  if (need.minSpan == 0) return p;   // nothing moves
+
+  // ramp * span >= minArea with ramp <= span; the sum is smallest when
+  // they are equal (a triangle), unless the velocity limit forces span up
+  uint64_t span = isqrtCeil(need.minArea);
+  if (span < need.minSpan) span = need.minSpan;
+  uint64_t ramp = (need.minArea + span - 1) / span;
+  if (ramp < 1) ramp = 1;
+
+  // stretch: same ramp/cruise proportions, never a shorter ramp
+  const uint64_t n = ramp + span;
+  if (minSteps > n) {
+    uint64_t span2 = (span * minSteps + n - 1) / n;
+    uint64_t ramp2 = minSteps - span2;
+    if (ramp2 < ramp) {
+      ramp2 = ramp;
+      span2 = minSteps - ramp;
+    }
+    ramp = ramp2;
+    span = span2;
+  }
+  if (ramp > PROFILE_MAX_RAMP) ramp = PROFILE_MAX_RAMP;   // only with very long durations
+  p.ramp = (uint16_t)ramp;
+  p.cruise = (uint32_t)(span - ramp);
+  return p;
+}
+
+// One axis of an absolute move; both axes share the move's ProfilePlan.
+struct AxisMove {
+  q16_t start;
+  q16_t dist;
+
+  q16_t at(const ProfilePlan &plan, uint32_t k) const {
+    return start + (q16_t)(((int64_t)dist * plan.fraction(k)) >> 16);
+  }
+};
+
+// Velocity (Q16 degrees per step, signed) for an axis chasing a target that
+// is `err` away and may move at any time: the fastest it can go and still
+// stop on it, braking one step of acceleration per step, v(v + a)/2a <=
+// |err|; never more than |err| itself.
+inline q16_t approachVelocity(q16_t err, const AxisLimits &lim, uint32_t stepUs) {
+  const uint64_t e = err < 0 ? -(int64_t)err : err;
+  const uint64_t a = accPerStep(lim, stepUs);
+  uint64_t r = isqrtCeil(a * a + 8 * a * e);
+  if (r * r > a * a + 8 * a * e) r--;
+  uint64_t v = (r - a) / 2;
+  const uint64_t vMax = velPerStep(lim, stepUs);
+  if (v > vMax) v = vMax;
+  if (v > e) v = e;
+  return err < 0 ? -(q16_t)v : (q16_t)v;
+}
@@ -0,0 +1,132 @@
+/*
+  path_planner.h
+  - Blended MOVE chains: MOVEs sent with "queue" run one after another as
+    one path, and the servos go through each waypoint at a corner speed
+    instead of stopping there.
+  - PathSeg: one straight segment in pan/tilt space, driven along its
+    length (Q16 degrees). Speed and acceleration along it are the most
+    both axes allow in that direction.
+  - Corner speed: the path speed at which turning onto the next segment
+    changes neither axis' velocity by more than its acceleration limit
+    gives in `cornerUs`. A velocity in deg/s, so the same path runs the
+    same at any step interval. Straight on has no corner limit.
+  - Lookahead: a backward pass over the known chain (the last segment ends
+    at rest, nothing is known after it) gives the fastest speed each
+    waypoint can be passed at and still brake for everything behind it.
+    Only the active segment's exit speed is kept; it is redone whenever
+    the chain changes.
+  - PathRun drives the active segment one step at a time: accelerate,
+    cruise or brake so as to arrive at the exit speed. Trapezoid ramps; a
+    MOVE without "queue" keeps its closed-form profile (motion_profile.h).
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "motion_profile.h"
+
+struct PathSeg {
+  q16_t startPan, startTilt;
+  q16_t distPan, distTilt;
+  int64_t len;     // Q16 degrees, straight-line length in pan/tilt space
+  int64_t vMax;    // along the path, Q16 degrees per step
+  int64_t acc;     // Q16 degrees per step^2
+
+  // A duration (in steps) only lowers the cruise speed.
+  void init(q16_t fromPan, q16_t fromTilt, q16_t toPan, q16_t toTilt, const AxisLimits &panLim,
+            const AxisLimits &tiltLim, uint32_t stepUs, uint32_t minSteps = 0) {
+    startPan = fromPan; startTilt = fromTilt;
+    distPan = toPan - fromPan; distTilt = toTilt - fromTilt;
+    len = (int64_t)isqrtCeil((uint64_t)((int64_t)distPan * distPan + (int64_t)distTilt * distTilt));
+    vMax = acc = INT64_MAX;
+    limit(distPan, panLim, stepUs);
+    limit(distTilt, tiltLim, stepUs);
+    if (!len) vMax = acc = 0;   // nothing to drive; step() ends it at once
+    if (minSteps && len / minSteps < vMax) vMax = len / minSteps > 0 ? len / minSteps : 1;
+  }
+
+  q16_t panAt(int64_t s) const { return len ? startPan + (q16_t)(distPan * s / len) : startPan + distPan; }
+  q16_t tiltAt(int64_t s) const { return len ? startTilt + (q16_t)(distTilt * s / len) : startTilt + distTilt; }
+
+private:
+  // an axis covering |d| of len runs at |d|/len of the path speed
+  void limit(q16_t d, const AxisLimits &lim, uint32_t stepUs) {
+    const int64_t ad = d < 0 ? -(int64_t)d : d;
+    if (!ad) return;
+    const int64_t v = (int64_t)velPerStep(lim, stepUs) * len / ad;
+    const int64_t a = (int64_t)accPerStep(lim, stepUs) * len / ad;
+    if (v < vMax) vMax = v;
+    if (a < acc) acc = a;
+  }
+};
+
+// Velocity an axis gains in `us` at its acceleration limit, Q16 degrees
+// per step; 0 when us is 0 (stop at every corner).
+inline uint64_t velJumpPerStep(const AxisLimits &lim, uint32_t stepUs, uint32_t us) {
+  return (((uint64_t)lim.maxAccDps2 * us / 1000 * stepUs) << 16) / 1000000000;
+}
+
+// Highest speed that can still come down to `exit` within `dist`, one
+// step of `acc` at a time: v + (v - acc) + ... + exit <= dist, or
+// v^2 + acc*v <= exit^2 + acc*exit + 2*acc*dist.
+inline int64_t brakeSpeed(int64_t exit, int64_t acc, int64_t dist) {
+  const uint64_t c = (uint64_t)(exit * exit + acc * exit + 2 * acc * dist);
+  return ((int64_t)isqrtCeil((uint64_t)acc * acc + 4 * c) - acc) / 2;
+}
+
+// Speed to pass from a to b at. Per axis, the velocity jump is
+// v * |b.dist/b.len - a.dist/a.len|; with q = that difference times a.len,
+// v <= jump * a.len / q. A zero-length segment is a stop.
+inline int64_t cornerSpeed(const PathSeg &a, const PathSeg &b, const AxisLimits &panLim,
+                           const AxisLimits &tiltLim, uint32_t stepUs, uint32_t cornerUs) {
+  if (!a.len || !b.len) return 0;
+  int64_t v = a.vMax < b.vMax ? a.vMax : b.vMax;
+  const q16_t da[2] = {a.distPan, a.distTilt}, db[2] = {b.distPan, b.distTilt};
+  const AxisLimits *lim[2] = {&panLim, &tiltLim};
+  for (int i = 0; i < 2; i++) {
+    int64_t q = (int64_t)db[i] * a.len / b.len - da[i];
+    if (q < 0) q = -q;
+    if (!q) continue;
+    const int64_t jump = (int64_t)velJumpPerStep(*lim[i], stepUs, cornerUs);
+    const int64_t c = jump * a.len / q;
+    if (c < v) v = c;
+  }
+  return v;
+}
+
+// Exit speed of segs[0] with segs[1..n-1] queued behind it.
+inline int64_t planExitSpeed(const PathSeg *segs, size_t n, const AxisLimits &panLim,
+                             const AxisLimits &tiltLim, uint32_t stepUs, uint32_t cornerUs) {
+  int64_t exit = 0;   // of segs[k], walking back from the end
+  for (size_t k = n - 1; k > 0; k--) {
+    int64_t entry = brakeSpeed(exit, segs[k].acc, segs[k].len);
+    if (entry > segs[k].vMax) entry = segs[k].vMax;
+    const int64_t corner = cornerSpeed(segs[k - 1], segs[k], panLim, tiltLim, stepUs, cornerUs);
+    exit = entry < corner ? entry : corner;
+  }
+  return exit;
+}
+
+struct PathRun {
+  PathSeg seg;
+  int64_t s = 0;      // covered so far, Q16 degrees
+  int64_t v = 0;      // Q16 degrees per step
+  int64_t exit = 0;   // speed to arrive at the end with
+
+  // One step along the segment. True once at the end; `over` is how far
+  // this step's speed would have carried past it.
+  bool step(int64_t &over) {
+    int64_t next = v + seg.acc;
+    if (next > seg.vMax) next = seg.vMax;
+    const int64_t brake = brakeSpeed(exit, seg.acc, seg.len - s);
+    if (next > brake) next = brake;
+    v = next > 1 ? next : 1;
+    s += v;
+    over = 0;
+    if (s < seg.len) return false;
+    over = s - seg.len;
+    s = seg.len;
+    return true;
+  }
+};
@@ -0,0 +1,60 @@
+/*
+  seqlock.h
+  - Single-writer sequence lock for publishing a small trivially copyable
+    snapshot to readers on the other core.
+  - The writer never waits: it bumps the sequence to odd, stores the words,
+    bumps it back to even. Readers copy and retry if the sequence was odd
+    or moved underneath them, so they always see one whole snapshot.
+  - The payload is kept as relaxed 32-bit atomics (plain aligned stores on
+    the ESP32), so the racing copy is still well defined.
+*/
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock payload is copied word by word");
+
+public:
+  explicit Seqlock(const T& initial = T()) { write(initial); }
+
+  // writer side (one writer only)
+  void write(const T& value) {
+    uint32_t tmp[WORDS] = {};
+    memcpy(tmp, &value, sizeof(T));
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) words_[i].store(tmp[i], std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  // any reader, any core
+  T read() const {
+    uint32_t tmp[WORDS];
+    uint32_t before, after;
+    do {
+      before = seq_.load(std::memory_order_acquire);
+      for (size_t i = 0; i < WORDS; i++) tmp[i] = words_[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = seq_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    T value;
+    memcpy(&value, tmp, sizeof(T));
+    return value;
+  }
+
+  // even, bumped by 2 per write
+  uint32_t version() const { return seq_.load(std::memory_order_acquire); }
+
+private:
+  static const size_t WORDS = (sizeof(T) + 3) / 4;
+
+  std::atomic<uint32_t> seq_{0};
+  std::atomic<uint32_t> words_[WORDS];
+};
@@ -0,0 +1,67 @@
+/*
+  servo_cal.h
+  - Angle -> pulse width per servo, for Servo::writeMicroseconds(): the
+    motion core keeps Q16.16 angles and the output gets the full pulse
+    resolution (1 us is about 0.1 deg) instead of whole degrees.
+  - A calibration is the pulse width at SERVO_CAL_POINTS evenly spaced
+    angles over 0..180 deg, interpolated linearly in between.
+  - SERVO_CAL_3PT(us0, us90, us180) builds one at compile time from three
+    measured pulse widths; SERVO_CAL_LINEAR(us0, us180) from two. A fully
+    measured servo can list all nine points instead.
+  - Integer only, a handful of operations per write.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#include "motion_profile.h"
+
+const int SERVO_CAL_POINTS = 9;      // every 22.5 deg
+const q16_t SERVO_CAL_SPAN = (180 << 16) / (SERVO_CAL_POINTS - 1);
+
+// ESP32Servo's defaults for attach(pin), i.e. what write(degrees) used
+const uint16_t SERVO_US_0 = 544;
+const uint16_t SERVO_US_180 = 2400;
+
+struct ServoCal {
+  uint16_t us[SERVO_CAL_POINTS];
+
+  int minUs() const {
+    int m = us[0];
+    for (int i = 1; i < SERVO_CAL_POINTS; i++) if (us[i] < m) m = us[i];
+    return m;
+  }
+
+  int maxUs() const {
+    int m = us[0];
+    for (int i = 1; i < SERVO_CAL_POINTS; i++) if (us[i] > m) m = us[i];
+    return m;
+  }
+
+  int pulseUs(q16_t deg) const {
+    if (deg <= 0) return us[0];
+    if (deg >= (180 << 16)) return us[SERVO_CAL_POINTS - 1];
+    const int i = deg / SERVO_CAL_SPAN;
+    const int32_t frac = deg - i * SERVO_CAL_SPAN;
+    const int32_t d = (int32_t)us[i + 1] - us[i];
+    return us[i] + (int)(((int64_t)d * frac + SERVO_CAL_SPAN / 2) / SERVO_CAL_SPAN);
+  }
+};
+
+// point i of a two-segment (0-90, 90-180) calibration, rounded to 1 us
+constexpr uint16_t servoCalPoint(int i, int us0, int us90, int us180) {
+  return (uint16_t)(2 * i <= SERVO_CAL_POINTS - 1
+      ? us0 + ((us90 - us0) * 2 * i + (SERVO_CAL_POINTS - 1) / 2) / (SERVO_CAL_POINTS - 1)
+      : us90 + ((us180 - us90) * (2 * i - (SERVO_CAL_POINTS - 1)) + (SERVO_CAL_POINTS - 1) / 2) / (SERVO_CAL_POINTS - 1));
+}
+
+#define SERVO_CAL_3PT(us0, us90, us180) \
+  ServoCal{{servoCalPoint(0, us0, us90, us180), servoCalPoint(1, us0, us90, us180), \
+            servoCalPoint(2, us0, us90, us180), servoCalPoint(3, us0, us90, us180), \
+            servoCalPoint(4, us0, us90, us180), servoCalPoint(5, us0, us90, us180), \
+            servoCalPoint(6, us0, us90, us180), servoCalPoint(7, us0, us90, us180), \
+            servoCalPoint(8, us0, us90, us180)}}
+
+#define SERVO_CAL_LINEAR(us0, us180) SERVO_CAL_3PT(us0, ((us0) + (us180)) / 2, us180)
+
+static_assert(SERVO_CAL_POINTS == 9, "SERVO_CAL_3PT lists nine points");
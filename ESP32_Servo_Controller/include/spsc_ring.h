@@ -0,0 +1,50 @@
+/*
+  spsc_ring.h
+  - Fixed-capacity single-producer / single-consumer ring for trivially
+    copyable items. No heap, no locks: the producer only writes head_, the
+    consumer only writes tail_, and acquire/release ordering on those two
+    counters publishes the slot contents across cores.
+  - N must be a power of two; counters run freely and wrap.
+*/
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value, "SpscRing items are copied with plain assignment");
+
+public:
+  // producer side
+  bool push(const T& item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == N) return false;
+    slots_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side
+  bool pop(T& out) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return false;
+    out = slots_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // either side; exact only from the consumer
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  T slots_[N];
+  alignas(32) std::atomic<uint32_t> head_{0};
+  alignas(32) std::atomic<uint32_t> tail_{0};
+};
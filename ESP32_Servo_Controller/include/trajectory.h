@@ -0,0 +1,50 @@
+/*
+  trajectory.h
+  - TRAJECTORY: a whole scan pattern in one message, up to TRAJ_MAX_POINTS
+    waypoints of (pan, tilt, time), run by core1 with linear interpolation
+    in time between them. A JSON upload stops at TRAJ_JSON_MAX_POINTS.
+  - TrajPoint keeps the time from the start of the trajectory, so finding
+    the segment for a step is a forward walk, never a sum.
+  - TrajUpload: the one buffer core0 decodes an upload into. core0 claims
+    it before decoding; core1 copies it into its own run buffer when the
+    command comes through cmdRing and releases it. An upload is never
+    rewritten under the motion task, and a second TRAJECTORY in that
+    short window is refused. Both buffers are static, nothing is allocated.
+*/
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const size_t TRAJ_MAX_POINTS = 512;
+const size_t TRAJ_JSON_MAX_POINTS = 256;   // JSON uploads: what the parse arena holds
+
+struct TrajPoint {
+  int16_t pan;       // centidegrees
+  int16_t tilt;
+  uint32_t tMs;      // from the start of the trajectory
+};
+
+class TrajUpload {
+public:
+  // core0: the buffer to decode into, or nullptr while core1 still owns it
+  TrajPoint* claim() {
+    bool free = false;
+    return busy_.compare_exchange_strong(free, true, std::memory_order_acquire) ? points_ : nullptr;
+  }
+
+  // core0, when the upload never made it to core1
+  void release() { busy_.store(false, std::memory_order_release); }
+
+  // core1: copy the first n points out and hand the buffer back
+  void takeInto(TrajPoint* out, size_t n) {
+    memcpy(out, points_, n * sizeof(TrajPoint));
+    release();
+  }
+
+private:
+  TrajPoint points_[TRAJ_MAX_POINTS];
+  std::atomic<bool> busy_{false};
+};
@@ -0,0 +1,99 @@
+/*
+  tx_frame.h
+  - Allocation-free builder for outbound WebSocket frames.
+  - Writes into caller-owned (static) storage and keeps
+    WEBSOCKETS_MAX_HEADER_SIZE bytes free in front of the payload, so the
+    client can put the frame header in place (headerToPayload = true)
+    instead of malloc'ing a header+payload copy.
+  - JSON is stitched together from literal fragments; only ids and numbers
+    are formatted per message.
+*/
+#pragma once
+
+#include <WebSocketsClient.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+template <size_t N>
+class TxFrame {
+public:
+  void clear() { len_ = 0; overflow_ = false; }
+  size_t length() const { return len_; }
+  bool overflowed() const { return overflow_; }
+  uint8_t* payload() { return buf_ + WEBSOCKETS_MAX_HEADER_SIZE; }
+
+  // string literal, length known at compile time
+  template <size_t M>
+  TxFrame& lit(const char (&s)[M]) { return raw(s, M - 1); }
+
+  TxFrame& raw(const void* p, size_t n) {
+    if (len_ + n > N) { overflow_ = true; return *this; }
+    memcpy(payload() + len_, p, n);
+    len_ += n;
+    return *this;
+  }
+
+  TxFrame& cstr(const char* s) { return raw(s, strlen(s)); }
+
+  // JSON string body (no surrounding quotes)
+  TxFrame& jstr(const char* s) {
+    static const char hex[] = "0123456789abcdef";
+    for (; *s; s++) {
+      uint8_t c = (uint8_t)*s;
+      if (c == '"' || c == '\\') {
+        char e[2] = {'\\', (char)c};
+        raw(e, 2);
+      } else if (c < 0x20) {
+        char e[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F]};
+        raw(e, 6);
+      } else {
+        raw(&c, 1);
+      }
+    }
+    return *this;
+  }
+
+  TxFrame& num(long v) {
+    char tmp[12];
+    size_t i = sizeof(tmp);
+    unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;
+    do { tmp[--i] = (char)('0' + u % 10); u /= 10; } while (u);
+    if (v < 0) tmp[--i] = '-';
+    return raw(tmp + i, sizeof(tmp) - i);
+  }
+
+  // counters: a uint32 past 2^31 would print negative through num(long),
+  // which is 32 bits on the ESP32
+  TxFrame& u32(uint32_t u) {
+    char tmp[10];
+    size_t i = sizeof(tmp);
+    do { tmp[--i] = (char)('0' + u % 10); u /= 10; } while (u);
+    return raw(tmp + i, sizeof(tmp) - i);
+  }
+
+  // fixed point with two decimals (centidegrees -> "90.25"; "90" when whole)
+  TxFrame& hundredths(long v) {
+    if (v < 0) { raw("-", 1); v = -v; }
+    num(v / 100);
+    const int frac = (int)(v % 100);
+    if (frac) {
+      char tmp[3] = {'.', (char)('0' + frac / 10), (char)('0' + frac % 10)};
+      raw(tmp, frac % 10 ? 3 : 2);
+    }
+    return *this;
+  }
+
+  // 64-bit timestamps; kept apart so num() stays 32-bit math on the ESP32
+  TxFrame& u64(uint64_t u) {
+    char tmp[20];
+    size_t i = sizeof(tmp);
+    do { tmp[--i] = (char)('0' + u % 10); u /= 10; } while (u);
+    return raw(tmp + i, sizeof(tmp) - i);
+  }
+
+private:
+  uint8_t buf_[WEBSOCKETS_MAX_HEADER_SIZE + N];
+  size_t len_ = 0;
+  bool overflow_ = false;
+};
@@ -0,0 +1,120 @@
+/*
+  visual_servo.h
+  - On-device closed loop for TRACK_ERR: the camera reports where the
+    target is relative to the image center, core1 turns it into a velocity
+    at every step instead of the server doing it once per frame.
+  - PoseHistory: servo angles over the last POSE_HISTORY_LEN steps. An
+    error measured on a frame taken before the network and the vision code
+    got to it belongs to the pose at that moment: target = pose(frame) +
+    error.
+  - TrackAxis: per-axis alpha-beta filter (a fixed-gain Kalman filter for
+    a constant-velocity target) over those measured target angles. Frames
+    come at camera rate and arrive late; every step the estimate is carried
+    forward from the frame's capture time to the end of the step, and the
+    axis runs at the estimated target velocity plus a P correction toward
+    the predicted angle. No lag on a steady target, and the loop keeps
+    steering between frames instead of holding the last error.
+  - Core1 only; Q16.16 degrees throughout (motion_profile.h).
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "motion_profile.h"
+
+const size_t POSE_HISTORY_LEN = 64;   // 0.96 s at the default 15 ms step
+
+class PoseHistory {
+public:
+  void add(int64_t us, q16_t pan, q16_t tilt) {
+    poses_[next_] = Pose{us, pan, tilt};
+    next_ = (next_ + 1) % POSE_HISTORY_LEN;
+    if (n_ < POSE_HISTORY_LEN) n_++;
+  }
+
+  // Pose at `us`, interpolated between the steps around it; clamped to the
+  // oldest/newest kept. False if nothing was recorded yet.
+  bool at(int64_t us, q16_t &pan, q16_t &tilt) const {
+    if (n_ == 0) return false;
+    const Pose* newer = &get(0);
+    if (us >= newer->us) { pan = newer->pan; tilt = newer->tilt; return true; }
+    for (size_t i = 1; i < n_; i++) {
+      const Pose &older = get(i);
+      if (us >= older.us) {
+        const int64_t span = newer->us - older.us, into = us - older.us;
+        pan = older.pan + (q16_t)(((int64_t)(newer->pan - older.pan) * into) / (span ? span : 1));
+        tilt = older.tilt + (q16_t)(((int64_t)(newer->tilt - older.tilt) * into) / (span ? span : 1));
+        return true;
+      }
+      newer = &older;
+    }
+    pan = newer->pan; tilt = newer->tilt;
+    return true;
+  }
+
+private:
+  struct Pose {
+    int64_t us;
+    q16_t pan;
+    q16_t tilt;
+  };
+
+  // i = 0 is the newest
+  const Pose& get(size_t i) const { return poses_[(next_ + POSE_HISTORY_LEN - 1 - i) % POSE_HISTORY_LEN]; }
+
+  Pose poses_[POSE_HISTORY_LEN];
+  size_t n_ = 0, next_ = 0;
+};
+
+struct TrackGains {
+  uint16_t kpMilli;      // deg/s of correction per degree off the prediction, x1000
+  uint16_t alphaMilli;   // share of a frame's residual taken into the angle, x1000
+  uint16_t betaMilli;    // ... into the velocity (per frame interval), x1000
+};
+
+struct TrackAxis {
+  static const int32_t MAX_RATE = 1000 * Q16_ONE;   // deg/s; frames too close together
+  static const int64_t PREDICT_MAX_US = 500000;     // never extrapolate further
+
+  q16_t angle = 0;        // estimated target angle at frameUs
+  int32_t rate = 0;       // estimated target velocity, Q16 deg/s
+  int64_t frameUs = 0;    // capture time of the last frame used, 0 = none yet
+
+  void reset() { *this = TrackAxis(); }
+
+  q16_t predict(int64_t us) const {
+    int64_t dt = us - frameUs;
+    if (dt < 0) dt = 0;
+    if (dt > PREDICT_MAX_US) dt = PREDICT_MAX_US;
+    return angle + (q16_t)((int64_t)rate * dt / 1000000);
+  }
+
+  // One frame: the target was at `measured` at `us`. Frames older than the
+  // last one used are dropped.
+  void update(q16_t measured, int64_t us, const TrackGains &g) {
+    if (!frameUs) {
+      angle = measured;
+      rate = 0;
+      frameUs = us;
+      return;
+    }
+    if (us <= frameUs) return;
+    const int64_t dt = us - frameUs;
+    const q16_t predicted = predict(us);
+    const int64_t resid = (int64_t)measured - predicted;
+    const int64_t r = rate + resid * g.betaMilli * 1000 / dt;   // 1e6 us/s over 1000
+    rate = (int32_t)(r > MAX_RATE ? MAX_RATE : r < -MAX_RATE ? -MAX_RATE : r);
+    angle = predicted + (q16_t)(resid * g.alphaMilli / 1000);
+    frameUs = us;
+  }
+
+  // Velocity command for the step starting at nowUs, Q16 degrees per step:
+  // the target's velocity, plus a correction toward where it will be in the
+  // middle of the step (the new angle is held for the whole step).
+  q16_t velocity(q16_t pos, int64_t nowUs, const TrackGains &g, uint32_t stepUs) const {
+    const int64_t ff = (int64_t)rate * stepUs / 1000000;
+    const int64_t e = (int64_t)predict(nowUs + stepUs / 2) - (pos + ff);
+    return (q16_t)(ff + e * g.kpMilli * (int64_t)stepUs / 1000000000);
+  }
+};
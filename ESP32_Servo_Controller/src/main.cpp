@@ -1,13 +1,40 @@
 /*
   esp32_dualcore_servo_dir.ino
-  - Core0: WebSocket client + command parsing + ACK/STATUS sending
-  - Core1: Motion task (absolute + directional modes)
+  - Core0: WebSocket client + command parsing + ACK sending; the only code
+    that touches the WebSocket stack
+  - Core1: Motion task (absolute + directional modes), owns the command
+    queue and motion state; fed through a lock-free SPSC ring, publishes a
+    MotionState snapshot through a seqlock and queues STATUS events for
+    core0 to send. Steps are paced by an esp_timer (STEP_INTERVAL_US) that
+    wakes the task.
   - Supports:
-      * MOVE      -> absolute target
+      * MOVE      -> absolute target; both axes on one velocity/acceleration-
+                     limited profile (straight line), optional duration_ms;
+                     "queue" MOVEs wait their turn and blend through the
+                     waypoints (include/path_planner.h)
       * CANCEL    -> cancel specific command
       * STATUS_REQ-> immediate status
-      * MOVE_DIR  -> continuous directional movement
+      * MOVE_DIR  -> continuous directional movement (fixed degrees per step)
+      * MOVE_VEL  -> continuous signed velocity per axis, deg/s
+      * TRACK_ERR -> target pixel error per camera frame; core1 closes the
+                     loop at the step rate on a predicted target
+                     (alpha-beta filter, include/visual_servo.h)
+      * TRAJECTORY-> up to 512 timed waypoints in one message (256 as JSON),
+                     interpolated
+                     on core1 with optional progress STATUS
+                     (include/trajectory.h)
+      * COALESCE  -> per connection: plain MOVEs become latest-wins targets,
+                     no ACK and no STATUS per MOVE, a periodic position
+                     STATUS instead
       * STOP      -> stop directional movement
+      * TRACE_DUMP-> stream the per-command latency trace (binary frames)
+      * STATS     -> firmware performance counters
+      * PING      -> PONG with our receive/send timestamps (RTT, clock offset)
+  - MOVE/MOVE_DIR may carry execute_at (server clock): core1 holds them and
+    starts them at that instant. Core0 keeps the clock offset with its own
+    SYNC_REQ/SYNC exchange (include/clock_sync.h).
+  - Commands arrive as JSON text frames or as fixed-layout binary frames
+    (include/bin_proto.h); ACK/STATUS answer in the format the command used.
   Libraries required:
   - WebSocketsClient
   - ArduinoJson (v6)
@@ -18,7 +45,22 @@
 #include <WebSocketsClient.h>
 #include <ArduinoJson.h>
 #include <ESP32Servo.h>
-#include <deque>
+#include <esp_timer.h>
+#include "json_arena.h"
+#include "bin_proto.h"
+#include "tx_frame.h"
+#include "cmd_id.h"
+#include "cmd_trace.h"
+#include "clock_sync.h"
+#include "motion_profile.h"
+#include "servo_cal.h"
+#include "visual_servo.h"
+#include "path_planner.h"
+#include "trajectory.h"
+#include "fw_stats.h"
+#include "motion_cmd.h"
+#include "spsc_ring.h"
+#include "seqlock.h"
 
 // ---------- CONFIG ----------
 const char* WIFI_SSID = "Control_and_Command";
@@ -37,132 +79,460 @@ const int TILT_MIN = 0;
 const int TILT_MAX = 180;
 const int TILT_MIN_SAFE = 45;  // NEW: minimum tilt for safety
 
-const int STEP_INTERVAL_MS = 15;
-const int STEP_SIZE = 1;
-const unsigned long COMMAND_TIMEOUT_MS = 4000UL;
+// Pulse width per angle (include/servo_cal.h). These reproduce what
+// Servo::write(degrees) did; measure each servo and use SERVO_CAL_3PT.
+const ServoCal PAN_CAL = SERVO_CAL_LINEAR(SERVO_US_0, SERVO_US_180);
+const ServoCal TILT_CAL = SERVO_CAL_LINEAR(SERVO_US_0, SERVO_US_180);
+
+// Motion tuning. The host simulator (host/sim_motion.cpp) builds with
+// MOTION_TUNABLE defined empty so it can sweep these at runtime.
+#ifndef MOTION_TUNABLE
+#define MOTION_TUNABLE const
+#endif
+MOTION_TUNABLE unsigned long STEP_INTERVAL_US = 15000UL;  // step timer period
+// Absolute MOVE profile and per-axis limits (include/motion_profile.h)
+MOTION_TUNABLE ProfileShape MOTION_PROFILE = PROFILE_SCURVE;
+MOTION_TUNABLE AxisLimits PAN_LIMITS = {300, 1500};    // deg/s, deg/s^2
+MOTION_TUNABLE AxisLimits TILT_LIMITS = {200, 1000};   // carries the payload
+MOTION_TUNABLE unsigned long COMMAND_TIMEOUT_MS = 4000UL;   // MOVE_DIR/MOVE_VEL; also the longest lease
+// Queued MOVEs: at a waypoint each axis' velocity may jump by at most what
+// its acceleration limit gives in this long (90 deg/s pan, 60 deg/s tilt),
+// whatever STEP_INTERVAL_US is; 0 stops at every turn
+MOTION_TUNABLE unsigned long CORNER_JUMP_US = 60000UL;
+// TRACK_ERR loop (include/visual_servo.h); alpha 1, beta 0 turns the
+// prediction off (plain P on the last frame). Full output for TRACK_HOLD_MS
+// after the last frame, then fading to zero over TRACK_DECAY_MS, then TIMEOUT.
+MOTION_TUNABLE TrackGains TRACK_GAINS = {15000, 700, 300};  // kp 15 /s, alpha 0.7, beta 0.3
+MOTION_TUNABLE unsigned long TRACK_HOLD_MS = 100;
+MOTION_TUNABLE unsigned long TRACK_DECAY_MS = 200;
+// Coalesced MOVEs: SUCCESS once on target with no new one for this long (a
+// stream keeps one command running instead of stop-and-go STATUS pairs)
+MOTION_TUNABLE unsigned long LATEST_SETTLE_MS = 250;
+const uint16_t TRACK_DEFAULT_W = 640;         // frame size and field of view
+const uint16_t TRACK_DEFAULT_H = 480;         // when a TRACK_ERR leaves them out
+const uint16_t TRACK_DEFAULT_FOV_H_CDEG = 6000;
+const uint16_t TRACK_DEFAULT_FOV_V_CDEG = 4500;
+const unsigned long MOVE_TIMEOUT_SLACK_MS = 250;  // MOVE: plan time x1.5 + this
+// Parse arena for one inbound frame, sized for the biggest: a JSON
+// TRAJECTORY of TRAJ_JSON_MAX_POINTS points, 3 values each at up to 16 B
+// (a fractional value takes two 8 B slots on ESP32), plus 8 KB for the
+// rest of the frame and ArduinoJson allocating slots a pool at a time.
+const size_t JSON_RX_ARENA_BYTES = TRAJ_JSON_MAX_POINTS * 3 * 16 + 8192;
+// Largest outbound frame: JSON STATS with every counter at 10 digits is
+// under 512 B of fixed keys plus 64 B per message type ("NAME":n in rx,
+// "NAME":[avg,max] in handler_us). bench_status renders that worst case.
+const size_t TX_FRAME_BYTES = 512 + 64 * MSG_COUNT;
+const size_t CMD_RING_LEN = 16;            // core0 -> core1 hand-off (power of two)
+const size_t CMD_QUEUE_LEN = 16;           // commands waiting their turn on core1
+const size_t STATUS_RING_LEN = 32;         // core1 -> core0 STATUS events (power of two)
+const size_t STATUS_BATCH = 8;             // STATUS events sent per loop() pass
+const size_t TRACE_LEN = 128;              // command latency records kept (32 B each)
+const unsigned long JITTER_LOG_MS = 10000; // step-timer jitter report period (0 = off)
+const size_t CMD_SCHED_LEN = 8;            // execute_at commands waiting on core1
+const unsigned long SCHEDULE_AHEAD_MAX_MS = 5000; // furthest execute_at accepted
+const unsigned long SYNC_INTERVAL_MS = 2000;      // SYNC_REQ period once synced
+const unsigned long SYNC_FAST_MS = 250;           // ... while filling the window
 // --------------------------------
 
 WebSocketsClient webSocket;
 Servo servoPan, servoTilt;
 
-// Command struct (for absolute MOVE queue)
-struct Cmd {
-  String id;
-  int pan;
-  int tilt;
-};
+// Commands from core0 to core1. webSocketEvent is the only producer and
+// taskMotion the only consumer, so no lock is needed (include/spsc_ring.h).
+SpscRing<Cmd, CMD_RING_LEN> cmdRing;
 
-// command queue
-std::deque<Cmd> cmdQueue;
+// TRAJECTORY points ride beside cmdRing: too big for a Cmd slot.
+TrajUpload trajUpload;
 
-// Active command state
-volatile bool hasActive = false;
-String activeCmdId = "";
-volatile uint8_t activeMode = 0; // 0 = NONE, 1 = ABSOLUTE, 2 = DIRECTIONAL
+// Coalesce mode (core0, per connection): plain MOVEs skip the ACK and
+// cmdRing and overwrite the one target slot; core1 follows whatever is
+// newest. latestSeq numbers them so core1 can keep them in order with the
+// commands going through cmdRing.
+bool coalesceOn = false;
+uint16_t coalesceReportMs = 0;
+uint32_t latestSeq = 0;
+Seqlock<Cmd> latestMove;
 
-volatile int currentPan = 90;
-volatile int currentTilt = 90;
-volatile float targetPan = 90.0f;
-volatile float targetTilt = 90.0f;
-volatile bool cancelFlag = false;
-volatile bool preemptFlag = false;
-volatile unsigned long cmdStartMillis = 0;
+// STATUS events back from core1, so a slow TCP send never stalls a step.
+// taskMotion is the only producer, loop() the only consumer.
+SpscRing<StatusEvent, STATUS_RING_LEN> statusRing;
 
-// Directional movement variables
-volatile int8_t panDir = 0;    // -1=LEFT, 0=NONE, +1=RIGHT
-volatile int8_t tiltDir = 0;   // -1=DOWN, 0=NONE, +1=UP
-volatile uint8_t moveSpeed = 1; // degrees per step
+// ---------- STATS counters ----------
+// WebSocket task only
+uint32_t rxCount[MSG_COUNT];
+uint32_t parseFailures = 0;
+uint32_t ringFull = 0;       // cmdRing full, rejected before core1
+HandlerTiming handlerTiming[MSG_COUNT];
+// written by the motion task, read by STATS
+StatCounter queueFull;       // MOVE queue full
+StatCounter ringHighWater;
+StatCounter queueHighWater;
+StatCounter preemptCount, cancelCount, timeoutCount, expiredCount;
+StatCounter stepOverruns;
+StatCounter statusDropped;   // STATUS events lost to a full statusRing
+StatCounter coalescedCount;  // coalesced targets overwritten before core1 took one
 
-// forward declarations
-void sendJSON(const JsonDocument &doc);
-void sendAck(const String &id);
-void sendStatus(const String &id, const char* state, const char* error = nullptr);
+// Finished command traces (include/cmd_trace.h); written and dumped by core0 only.
+TraceRing<TRACE_LEN> traceRing;
+CmdTimes rxTimes;            // timestamps of the frame being handled
+int64_t rxAtUs = 0;          // full esp_timer time of the frame being handled
+BinSched rxSched;            // priority and deadline of the frame being handled
 
-// ---------- WebSocket callbacks on core0 ----------
-void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
-  if (type == WStype_CONNECTED) {
-    Serial.println("[WS] connected");
-    StaticJsonDocument<128> doc;
-    doc["type"] = "HELLO";
-    doc["node"] = "esp32_sentry";
-    sendJSON(doc);
+// Server clock offset (core0 only). Reset on every connect: the server's
+// clock is only meaningful for the session that sent it.
+ClockSync clockSync;
+bool wsConnected = false;
+uint32_t syncSeq = 0;
+int64_t syncSentUs = 0;      // our time in the outstanding SYNC_REQ, 0 = none
+unsigned long lastSyncMs = 0;
 
-  } else if (type == WStype_TEXT) {
-    String msg = String((char*)payload);
-    Serial.println("[WS RX] " + msg);
+// taskMotion sleeps until notified: by the step timer, or by core0 after a push.
+TaskHandle_t motionTask = nullptr;
+const uint32_t NOTIFY_STEP = 1 << 0;
+const uint32_t NOTIFY_CMD = 1 << 1;
+const uint32_t NOTIFY_SCHED = 1 << 2;   // a scheduled command is due
 
-    StaticJsonDocument<512> doc;
-    DeserializationError err = deserializeJson(doc, msg);
-    if (err) return;
+// Active command state (core1 only)
+bool hasActive = false;
+CmdId activeCmdId = CmdId::none();
+uint8_t activeMode = 0; // 0 = NONE, 1 = ABSOLUTE, 2 = VELOCITY (MOVE_DIR / MOVE_VEL), 3 = TRACK,
+                        // 4 = TRAJECTORY, 5 = LATEST (coalesced MOVEs)
+uint8_t activePriority = PRIO_NORMAL;
 
-    const char* t = doc["type"] | "";
+// Servo angles, Q16 degrees; written as calibrated pulse widths
+q16_t currentPan = degToQ16(90);
+q16_t currentTilt = degToQ16(90);
+int panUs = -1, tiltUs = -1;       // last pulse written
+unsigned long cmdStartMillis = 0;
+unsigned long activeTimeoutMs = 0;
+// A velocity command on a lease: activeTimeoutMs is the lease, renewed by
+// KEEPALIVE; once it lapses the servos brake to a stop, then TIMEOUT.
+bool activeLease = false;
 
-    // ---------- Absolute MOVE ----------
-    if (strcmp(t, "MOVE") == 0) {
-      const char* id = doc["id"] | "";
-      if (strlen(id) == 0) return;
-      int pan = doc["pan"] | currentPan;
-      int tilt = doc["tilt"] | currentTilt;
+// Absolute mode: both axes follow movePlan, evaluated at moveStep, or for
+// a queued MOVE (onPath) the blended path
+ProfilePlan movePlan;
+AxisMove panMove, tiltMove;
+uint32_t moveStep = 0;
+bool onPath = false;
+PathRun path;
 
-      // Enforce safe minimum tilt
-      tilt = max(tilt, TILT_MIN_SAFE);
+// Velocity mode, Q16 degrees per step. The velocity slews toward the
+// commanded one within the axis acceleration limit.
+q16_t velPan = 0, velTilt = 0;
+q16_t velPanCmd = 0, velTiltCmd = 0;
 
-      pan = constrain(pan, PAN_MIN, PAN_MAX);
-      tilt = constrain(tilt, TILT_MIN, TILT_MAX);
+// Track mode: where recent frames put the target, and where the servos
+// were when those frames were taken. TRACK runs on the velocity path.
+TrackAxis trackPan, trackTilt;
+PoseHistory poseHistory;
 
-      sendAck(String(id));
+// Trajectory mode: core1's copy of the upload, the time into it and the
+// next point due. The start pose stands in as point -1.
+TrajPoint trajRun[TRAJ_MAX_POINTS];
+size_t trajCount = 0, trajNext = 0;
+uint64_t trajUs = 0;
+q16_t trajFromPan = 0, trajFromTilt = 0;
 
-      noInterrupts();
-      Cmd c; c.id = String(id); c.pan = pan; c.tilt = tilt;
-      cmdQueue.push_back(c);
-      if (hasActive) preemptFlag = true;
-      interrupts();
+// Latest mode: the newest coalesced MOVE target, chased on the velocity
+// path. latestSeen is the last latestSeq taken.
+q16_t latestPan = 0, latestTilt = 0;
+uint32_t latestSeen = 0;
 
-    // ---------- CANCEL ----------
-    } else if (strcmp(t, "CANCEL") == 0) {
-      const char* id = doc["id"] | "";
-      if (strlen(id) == 0) return;
-      String sid = String(id);
-      bool found = false;
-
-      noInterrupts();
-      if (hasActive && activeCmdId == sid) {
-        cancelFlag = true;
-        found = true;
-      } else {
-        for (auto it = cmdQueue.begin(); it != cmdQueue.end(); ++it) {
-          if (it->id == sid) {
-            cmdQueue.erase(it);
-            found = true;
-            break;
-          }
-        }
+// Periodic MOVING STATUS of a TRAJECTORY or a coalesced target, 0 = none
+uint16_t reportEveryMs = 0;
+unsigned long reportedAt = 0;
+
+// What everyone else sees of the above. Core1 republishes after every
+// change; readers (STATUS frames, STATUS_REQ) get one consistent step and
+// never hold up the motion loop.
+struct MotionState {
+  CmdId cmdId;     // active command, empty when idle
+  int16_t pan;     // centidegrees
+  int16_t tilt;
+  uint8_t mode;    // activeMode
+  bool active;
+};
+Seqlock<MotionState> motionState(MotionState{CmdId::none(), 9000, 9000, 0, false});
+
+// forward declarations
+void sendHello();
+void sendAck(const CmdId &id);
+void sendStatus(const CmdId &id, CmdState state, CmdError error = ERR_NONE);
+void sendStatusFrame(const CmdId &id, CmdState state, CmdError error, int pan, int tilt, const CmdId* cmdId,
+                     uint16_t point = 0, uint16_t points = 0);
+void handleTraceDump();
+void handleStats(bool bin);
+void sendStats(const BinStats &st, bool bin);
+void handlePing(uint32_t seq, uint64_t serverUs, bool bin);
+void handleSync(uint32_t seq, uint64_t t, uint64_t serverRx, uint64_t serverTx);
+
+// Inbound frames are parsed straight from the client's buffer into an
+// arena-backed document: no String copy, no heap allocation per message.
+JsonArena<JSON_RX_ARENA_BYTES> rxArena;
+JsonDocument rxDoc(&rxArena);
+
+DeserializationError ingestJSON(const uint8_t* payload, size_t length) {
+  Serial.print("[WS RX] ");
+  Serial.write(payload, length);
+  Serial.println();
+
+  rxDoc.clear();
+  rxArena.reset();
+  return deserializeJson(rxDoc, (const char*)payload, length);
+}
+
+// A frame that ran the arena out is lost, but a TRAJECTORY sender still
+// waits on its id. Parse it again keeping only "type" and "id" and refuse
+// it, so an oversized upload gets an answer instead of silence. The filter
+// and the second parse share the (now empty) arena.
+void refuseOversized(const uint8_t* payload, size_t length) {
+  rxDoc.clear();
+  rxArena.reset();
+  JsonDocument filter(&rxArena);
+  filter["type"] = true;
+  filter["id"] = true;
+  if (deserializeJson(rxDoc, (const char*)payload, length, DeserializationOption::Filter(filter))) return;
+  if (msgTypeFromName(rxDoc["type"] | "") != MSG_TRAJECTORY) return;
+  const CmdId id = CmdId::text(rxDoc["id"] | "");
+  if (!id.empty()) sendStatus(id, ST_ERROR, ERR_BAD_TRAJECTORY);
+}
+
+// ---------- Command handlers (shared by the JSON and binary decoders) ----------
+// Core0 validates, ACKs and hands the command to core1; everything that
+// touches motion state happens in taskMotion.
+void traceFinish(const CmdId &id, CmdOp op, const CmdTimes &t, CmdState state, CmdError error) {
+  TraceRecord r = {traceTag(id), op, state, error, 0, t};
+  r.t.status = traceNow();
+  traceRing.add(r);
+}
+
+// False if it didn't get to core1 (ERROR STATUS already sent): a deadline
+// before the first clock sync (no ACK), or cmdRing full. Motion commands
+// take the frame's priority and deadline.
+bool submit(Cmd c) {
+  if (c.op != OP_STOP && c.op != OP_CANCEL) {
+    c.priority = min(rxSched.priority, (uint8_t)PRIO_URGENT);
+    if (rxSched.deadline_us) {
+      if (!clockSync.synced()) {
+        sendStatus(c.id, ST_ERROR, ERR_NOT_SYNCED);
+        return false;
       }
-      interrupts();
+      c.deadlineUs = max(clockSync.toLocal((int64_t)rxSched.deadline_us), (int64_t)1);
+    }
+  }
+  sendAck(c.id);
+  c.t = rxTimes;
+  c.t.acked = traceNow();
+  c.latestSeq = latestSeq;
+  if (!cmdRing.push(c)) {
+    ringFull++;
+    sendStatus(c.id, ST_ERROR, ERR_QUEUE_FULL);
+    traceFinish(c.id, c.op, c.t, ST_ERROR, ERR_QUEUE_FULL);
+    return false;
+  }
+  if (motionTask) xTaskNotify(motionTask, NOTIFY_CMD, eSetBits);
+  return true;
+}
+
+// execute_at (server clock, us) -> esp_timer time in startUs; 0 = run on
+// arrival. A time already past still counts as scheduled (starts at once,
+// ahead of queued MOVEs). False, with an ERROR STATUS, if it can't be met.
+bool resolveExecuteAt(const CmdId &id, uint64_t executeAt, int64_t &startUs) {
+  startUs = 0;
+  if (!executeAt) return true;
+  if (!clockSync.synced()) {
+    sendStatus(id, ST_ERROR, ERR_NOT_SYNCED);
+    return false;
+  }
+  startUs = clockSync.toLocal((int64_t)executeAt);
+  if (startUs - rxAtUs > (int64_t)SCHEDULE_AHEAD_MAX_MS * 1000) {
+    sendStatus(id, ST_ERROR, ERR_BAD_TIME);
+    return false;
+  }
+  if (startUs < 1) startUs = 1;
+  return true;
+}
+
+// Coalesce mode: no ACK, no cmdRing slot, nothing to reject; the target
+// replaces whatever core1 hasn't picked up yet. Always normal priority.
+void submitLatest(Cmd c) {
+  c.priority = PRIO_NORMAL;
+  c.t = rxTimes;
+  c.reportMs = coalesceReportMs;
+  c.latestSeq = ++latestSeq;
+  latestMove.write(c);
+  if (motionTask) xTaskNotify(motionTask, NOTIFY_CMD, eSetBits);
+}
+
+// pan/tilt in centidegrees
+void handleMove(const CmdId &id, int pan, int tilt, uint64_t executeAt = 0, uint16_t durationMs = 0,
+                bool queued = false) {
+  // Enforce safe minimum tilt
+  tilt = max(tilt, TILT_MIN_SAFE * 100);
+
+  pan = constrain(pan, PAN_MIN * 100, PAN_MAX * 100);
+  tilt = constrain(tilt, TILT_MIN * 100, TILT_MAX * 100);
+
+  Cmd c = {};
+  c.op = OP_MOVE; c.id = id; c.pan = pan; c.tilt = tilt; c.durationMs = durationMs; c.queued = queued;
+  if (coalesceOn && !executeAt && !durationMs && !queued && rxSched.priority == PRIO_NORMAL && !rxSched.deadline_us) {
+    submitLatest(c);
+    return;
+  }
+  if (!resolveExecuteAt(id, executeAt, c.startUs)) return;
+  submit(c);
+}
+
+void handleCancel(const CmdId &id) {
+  Cmd c = {};
+  c.op = OP_CANCEL; c.id = id;
+  submit(c);
+}
+
+void handleStatusReq(bool bin) {
+  const MotionState ms = motionState.read();
+  CmdState st = ms.active ? ST_BUSY : ST_IDLE;
+  if (bin) sendStatusFrame((ms.active && ms.cmdId.bin) ? ms.cmdId : CmdId::number(0), st, ERR_NONE, ms.pan, ms.tilt, nullptr);
+  else sendStatusFrame(CmdId::none(), st, ERR_NONE, ms.pan, ms.tilt, ms.active ? &ms.cmdId : nullptr);
+}
+
+void handleMoveDir(const CmdId &id, int8_t newPanDir, int8_t newTiltDir, int speed, uint64_t executeAt = 0,
+                   uint16_t leaseMs = 0) {
+  speed = max(1, min(10, speed));
+
+  Cmd c = {};
+  c.op = OP_MOVE_DIR; c.id = id;
+  c.panDir = newPanDir; c.tiltDir = newTiltDir; c.speed = (uint8_t)speed; c.leaseMs = leaseMs;
+  if (!resolveExecuteAt(id, executeAt, c.startUs)) return;
+  submit(c);
+}
+
+// centidegrees per second; the axis limits are applied on core1
+void handleMoveVel(const CmdId &id, int16_t panCdps, int16_t tiltCdps, uint64_t executeAt = 0,
+                   uint16_t leaseMs = 0) {
+  Cmd c = {};
+  c.op = OP_MOVE_VEL; c.id = id;
+  c.panVel = panCdps; c.tiltVel = tiltCdps; c.leaseMs = leaseMs;
+  if (!resolveExecuteAt(id, executeAt, c.startUs)) return;
+  submit(c);
+}
+
+// dx/dy pixels off the image center -> degrees (linear in the field of
+// view), frame time -> our clock. Without a time, or before the first
+// clock sync, the frame counts as taken on arrival.
+void handleTrackErr(const CmdId &id, int dx, int dy, unsigned w, unsigned h, unsigned fovH, unsigned fovV,
+                    uint64_t frameAt) {
+  if (!w) w = TRACK_DEFAULT_W;
+  if (!h) h = TRACK_DEFAULT_H;
+  if (!fovH) fovH = TRACK_DEFAULT_FOV_H_CDEG;
+  if (!fovV) fovV = TRACK_DEFAULT_FOV_V_CDEG;
+
+  Cmd c = {};
+  c.op = OP_TRACK_ERR; c.id = id;
+  c.panErr = (q16_t)((int64_t)dx * fovH * Q16_ONE / ((int64_t)w * 100));
+  c.tiltErr = (q16_t)((int64_t)dy * fovV * Q16_ONE / ((int64_t)h * 100));
+  c.frameUs = rxAtUs;
+  if (frameAt && clockSync.synced()) c.frameUs = min(clockSync.toLocal((int64_t)frameAt), rxAtUs);
+  submit(c);
+}
+
+// One TRAJECTORY waypoint, centidegrees, held to the same limits as a MOVE
+// target; tMs from the start.
+TrajPoint trajPoint(int pan, int tilt, uint32_t tMs) {
+  pan = constrain(pan, PAN_MIN * 100, PAN_MAX * 100);
+  tilt = constrain(max(tilt, TILT_MIN_SAFE * 100), TILT_MIN * 100, TILT_MAX * 100);
+  return TrajPoint{(int16_t)pan, (int16_t)tilt, tMs};
+}
+
+// The decoder has claimed trajUpload and filled n points into it; n = 0
+// means the upload was malformed. core1 hands the buffer back once it has
+// copied it, here it goes back if the command never gets there.
+void handleTrajectory(const CmdId &id, size_t n, uint16_t reportMs) {
+  if (n == 0) {
+    trajUpload.release();
+    sendStatus(id, ST_ERROR, ERR_BAD_TRAJECTORY);
+    return;
+  }
+  Cmd c = {};
+  c.op = OP_TRAJECTORY; c.id = id; c.points = (uint16_t)n; c.reportMs = reportMs;
+  if (!submit(c)) trajUpload.release();
+}
+
+// Session setting, no ACK; a new connection starts with it off.
+void handleCoalesce(bool on, uint16_t reportMs) {
+  coalesceOn = on;
+  coalesceReportMs = reportMs;
+  Serial.printf("[WS] coalesce %s, report every %u ms\n", on ? "on" : "off", reportMs);
+}
 
-      sendAck(sid);
-      if (found) sendStatus(sid, "CANCELLED", nullptr);
-      else sendStatus(sid, "ERROR", "not_active");
+// Renews a MOVE_DIR/MOVE_VEL lease. No ACK and no reply: sent many times
+// a second, it only has to reach core1. If cmdRing is full it is dropped,
+// and the next one renews instead.
+void handleKeepalive(const CmdId &id) {
+  Cmd c = {};
+  c.op = OP_KEEPALIVE; c.id = id;
+  c.latestSeq = latestSeq;
+  if (!cmdRing.push(c)) {
+    ringFull++;
+    return;
+  }
+  if (motionTask) xTaskNotify(motionTask, NOTIFY_CMD, eSetBits);
+}
+
+// An empty id stops whatever is active.
+void handleStop(const CmdId &id) {
+  Cmd c = {};
+  c.op = OP_STOP; c.id = id;
+  submit(c);
+}
+
+// ---------- Decoders ----------
+// Both decoders return what they handled so webSocketEvent can count it.
+MsgType dispatchJSON(JsonDocument &doc) {
+  const MsgType mt = msgTypeFromName(doc["type"] | "");
+  bool idFits = true;
+  CmdId id = CmdId::text(doc["id"] | "", &idFits);
+  if (!idFits) {
+    // reply with the id cut to CMD_ID_MAX_LEN so the server can still spot it
+    sendStatus(id, ST_ERROR, ERR_ID_TOO_LONG);
+    return mt;
+  }
+  // motion commands: priority class and start deadline (server clock, us)
+  rxSched.priority = (uint8_t)min(doc["priority"] | (unsigned)PRIO_NORMAL, (unsigned)PRIO_URGENT);
+  rxSched.deadline_us = doc["deadline"] | (uint64_t)0;
+
+  switch (mt) {
+    // ---------- Absolute MOVE ----------
+    case MSG_MOVE: {
+      if (id.empty()) break;
+      const MotionState ms = motionState.read();
+      float pan = doc["pan"] | ms.pan / 100.0f;     // degrees, fractions kept
+      float tilt = doc["tilt"] | ms.tilt / 100.0f;
+      unsigned long duration = doc["duration_ms"] | 0UL;
+      handleMove(id, (int)lroundf(constrain(pan, -300.0f, 300.0f) * 100),
+                 (int)lroundf(constrain(tilt, -300.0f, 300.0f) * 100),
+                 doc["execute_at"] | (uint64_t)0, (uint16_t)min(duration, 60000UL), doc["queue"] | false);
+      break;
+    }
+
+    // ---------- CANCEL ----------
+    case MSG_CANCEL:
+      if (id.empty()) break;
+      handleCancel(id);
+      break;
 
     // ---------- STATUS_REQ ----------
-    } else if (strcmp(t, "STATUS_REQ") == 0) {
-      StaticJsonDocument<256> st;
-      st["type"] = "STATUS";
-      st["id"] = "";
-      st["state"] = hasActive ? "BUSY" : "IDLE";
-      st["pan"] = currentPan;
-      st["tilt"] = currentTilt;
-      if (hasActive) st["cmd_id"] = activeCmdId.c_str();
-      sendJSON(st);
+    case MSG_STATUS_REQ:
+      handleStatusReq(false);
+      break;
 
     // ---------- MOVE_DIR ----------
-    } else if (strcmp(t, "MOVE_DIR") == 0) {
-      const char* id = doc["id"] | "";
-      if (strlen(id) == 0) return;
+    case MSG_MOVE_DIR: {
+      if (id.empty()) break;
       const char* pan_dir = doc["pan_dir"] | "NONE";
       const char* tilt_dir = doc["tilt_dir"] | "NONE";
       int speed = doc["speed"] | 1;
-      speed = max(1, min(10, speed));
 
       int8_t newPanDir = 0;
       int8_t newTiltDir = 0;
@@ -170,187 +540,1232 @@ void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
       else if (strcmp(pan_dir, "RIGHT") == 0) newPanDir = 1;
       if (strcmp(tilt_dir, "DOWN") == 0) newTiltDir = -1;
       else if (strcmp(tilt_dir, "UP") == 0) newTiltDir = 1;
+      handleMoveDir(id, newPanDir, newTiltDir, speed, doc["execute_at"] | (uint64_t)0,
+                    (uint16_t)min(doc["lease_ms"] | 0UL, 60000UL));
+      break;
+    }
 
-      // enforce safe tilt: block downward if at minimum
-      if (newTiltDir == -1 && currentTilt <= TILT_MIN_SAFE) newTiltDir = 0;
-
-      sendAck(String(id));
-      noInterrupts();
-      if (hasActive) sendStatus(activeCmdId, "PREEMPTED", nullptr);
-      activeCmdId = String(id);
-      activeMode = 2;
-      panDir = newPanDir;
-      tiltDir = newTiltDir;
-      moveSpeed = (uint8_t)speed;
-      hasActive = true;
-      cancelFlag = false;
-      preemptFlag = false;
-      cmdStartMillis = millis();
-      interrupts();
-
-      sendStatus(activeCmdId, "MOVING", nullptr);
+    // ---------- MOVE_VEL ----------
+    case MSG_MOVE_VEL: {
+      if (id.empty()) break;
+      float panDps = doc["pan_dps"] | 0.0f;
+      float tiltDps = doc["tilt_dps"] | 0.0f;
+      handleMoveVel(id, (int16_t)lroundf(constrain(panDps, -327.0f, 327.0f) * 100),
+                    (int16_t)lroundf(constrain(tiltDps, -327.0f, 327.0f) * 100),
+                    doc["execute_at"] | (uint64_t)0, (uint16_t)min(doc["lease_ms"] | 0UL, 60000UL));
+      break;
+    }
 
-    // ---------- STOP ----------
-    } else if (strcmp(t, "STOP") == 0) {
-      const char* id = doc["id"] | "";
-      String sid = String(id);
-      bool stopped = false;
-
-      noInterrupts();
-      if (hasActive) {
-        if (sid.length() == 0 || activeCmdId == sid) {
-          panDir = 0; tiltDir = 0;
-          activeMode = 0;
-          activeCmdId = "";
-          hasActive = false;
-          cancelFlag = false;
-          preemptFlag = false;
-          stopped = true;
+    // ---------- TRACK_ERR ----------
+    case MSG_TRACK_ERR: {
+      if (id.empty()) break;
+      handleTrackErr(id, constrain(doc["dx"] | 0, -32767, 32767), constrain(doc["dy"] | 0, -32767, 32767),
+                     doc["w"] | 0u, doc["h"] | 0u,
+                     (unsigned)lroundf(constrain(doc["fov_h"] | 0.0f, 0.0f, 180.0f) * 100),
+                     (unsigned)lroundf(constrain(doc["fov_v"] | 0.0f, 0.0f, 180.0f) * 100),
+                     doc["t"] | (uint64_t)0);
+      break;
+    }
+
+    // ---------- TRAJECTORY ----------
+    // "points" is flat: [pan, tilt, dt_ms, pan, tilt, dt_ms, ...], degrees
+    // and ms after the previous point (the first after the start). At most
+    // TRAJ_JSON_MAX_POINTS, what the parse arena holds; longer ones go binary.
+    case MSG_TRAJECTORY: {
+      if (id.empty()) break;
+      TrajPoint* pts = trajUpload.claim();
+      if (!pts) {
+        sendStatus(id, ST_ERROR, ERR_QUEUE_FULL);
+        break;
+      }
+      JsonArrayConst flat = doc["points"].as<JsonArrayConst>();
+      size_t n = flat.size() / 3, k = 0;
+      if (flat.size() % 3 || n > TRAJ_JSON_MAX_POINTS) n = 0;
+      float v[3];
+      uint32_t t = 0;
+      for (JsonVariantConst x : flat) {   // iterated: indexing walks the list every time
+        if (n == 0) break;
+        v[k % 3] = x | 0.0f;
+        if (++k % 3 == 0) {
+          t += (uint32_t)constrain(v[2], 0.0f, 65535.0f);
+          pts[k / 3 - 1] = trajPoint((int)lroundf(constrain(v[0], -300.0f, 300.0f) * 100),
+                                     (int)lroundf(constrain(v[1], -300.0f, 300.0f) * 100), t);
         }
       }
-      interrupts();
+      handleTrajectory(id, n, (uint16_t)min(doc["report_ms"] | 0UL, 60000UL));
+      break;
+    }
 
-      sendAck(sid);
-      if (stopped) sendStatus(sid.length() ? sid : String(""), "STOPPED", nullptr);
-      else sendStatus(sid.length() ? sid : String(""), "ERROR", "not_active");
+    // ---------- COALESCE ----------
+    case MSG_COALESCE:
+      handleCoalesce(doc["on"] | true, (uint16_t)min(doc["report_ms"] | 0UL, 60000UL));
+      break;
+
+    // ---------- STOP ----------
+    case MSG_STOP:
+      handleStop(id);
+      break;
+
+    // ---------- KEEPALIVE ----------
+    case MSG_KEEPALIVE:
+      if (id.empty()) break;
+      handleKeepalive(id);
+      break;
+
+    // ---------- TRACE_DUMP / STATS ----------
+    case MSG_TRACE_DUMP:
+      handleTraceDump();
+      break;
+    case MSG_STATS:
+      handleStats(false);
+      break;
+
+    // ---------- PING ----------
+    case MSG_PING:
+      handlePing(doc["seq"] | 0u, doc["t"] | (uint64_t)0, false);
+      break;
+
+    // ---------- SYNC (answer to our SYNC_REQ) ----------
+    case MSG_SYNC:
+      handleSync(doc["seq"] | 0u, doc["t"] | (uint64_t)0,
+                 doc["rx_us"] | (uint64_t)0, doc["tx_us"] | (uint64_t)0);
+      break;
+
+    default:
+      break;
+  }
+  return mt;
+}
+
+MsgType dispatchBIN(const uint8_t* payload, size_t length) {
+  if (length == 0) return MSG_INVALID;
+
+  switch (payload[0]) {
+    case BIN_MOVE: {
+      BinMove m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      rxSched = binSched(payload, length, sizeof(m) + 11);   // after execute_at, duration, flags
+      if (m.id) {
+        handleMove(CmdId::number(m.id), m.pan_cdeg, m.tilt_cdeg,
+                   binExecuteAt(payload, length, sizeof(m)),
+                   min(binDurationMs(payload, length, sizeof(m)), (uint16_t)60000),
+                   binMoveFlags(payload, length, sizeof(m)) & BIN_MOVE_QUEUE);
+      }
+      break;
+    }
+    case BIN_CANCEL: {
+      BinIdOnly m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      if (m.id) handleCancel(CmdId::number(m.id));
+      break;
+    }
+    case BIN_STATUS_REQ:
+      handleStatusReq(true);
+      break;
+    case BIN_TRACE_DUMP:
+      handleTraceDump();
+      break;
+    case BIN_STATS_REQ:
+      handleStats(true);
+      break;
+    case BIN_PING: {
+      BinPing m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      handlePing(m.seq, m.t_us, true);
+      break;
+    }
+    case BIN_SYNC: {
+      BinSync m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      handleSync(m.seq, m.t_us, m.rx_us, m.tx_us);
+      break;
+    }
+    case BIN_MOVE_DIR: {
+      BinMoveDir m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      rxSched = binSched(payload, length, sizeof(m) + sizeof(uint64_t));
+      if (m.id) {
+        handleMoveDir(CmdId::number(m.id), binDirDecode(m.dir_speed >> 6),
+                      binDirDecode((m.dir_speed >> 4) & 0x03), m.dir_speed & 0x0F,
+                      binExecuteAt(payload, length, sizeof(m)), binLeaseMs(payload, length, sizeof(m)));
+      }
+      break;
+    }
+    case BIN_MOVE_VEL: {
+      BinMoveVel m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      rxSched = binSched(payload, length, sizeof(m) + sizeof(uint64_t));
+      if (m.id) {
+        handleMoveVel(CmdId::number(m.id), m.pan_cdps, m.tilt_cdps, binExecuteAt(payload, length, sizeof(m)),
+                      binLeaseMs(payload, length, sizeof(m)));
+      }
+      break;
+    }
+    case BIN_TRACK_ERR: {
+      BinTrackErr m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      rxSched = binSched(payload, length, sizeof(m));
+      if (m.id) {
+        handleTrackErr(CmdId::number(m.id), m.dx_px, m.dy_px, m.width_px, m.height_px,
+                       m.fov_h_cdeg, m.fov_v_cdeg, m.frame_us);
+      }
+      break;
+    }
+    case BIN_TRAJECTORY: {
+      BinTrajHdr m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      if (!m.id) break;
+      const CmdId id = CmdId::number(m.id);
+      TrajPoint* pts = trajUpload.claim();
+      if (!pts) {
+        sendStatus(id, ST_ERROR, ERR_QUEUE_FULL);
+        break;
+      }
+      size_t n = m.count;
+      if (n > TRAJ_MAX_POINTS || length < sizeof(m) + n * sizeof(BinTrajPoint)) n = 0;
+      rxSched = binSched(payload, length, sizeof(m) + n * sizeof(BinTrajPoint));
+      uint32_t t = 0;
+      for (size_t i = 0; i < n; i++) {
+        BinTrajPoint p;
+        memcpy(&p, payload + sizeof(m) + i * sizeof(p), sizeof(p));
+        t += p.dt_ms;
+        pts[i] = trajPoint(p.pan_cdeg, p.tilt_cdeg, t);
+      }
+      handleTrajectory(id, n, min(m.report_ms, (uint16_t)60000));
+      break;
+    }
+    case BIN_COALESCE: {
+      BinCoalesce m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      handleCoalesce(m.on, min(m.report_ms, (uint16_t)60000));
+      break;
+    }
+    case BIN_STOP: {
+      BinIdOnly m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      handleStop(CmdId::number(m.id));
+      break;
+    }
+    case BIN_KEEPALIVE: {
+      BinIdOnly m;
+      if (!binRead(payload, length, m)) return MSG_INVALID;
+      if (m.id) handleKeepalive(CmdId::number(m.id));
+      break;
     }
   }
+  return msgTypeFromOp(payload[0]);
 }
 
-void sendJSON(const JsonDocument &doc) {
-  String out;
-  serializeJson(doc, out);
-  webSocket.sendTXT(out);
+// Per-type receive count and handler time (decode done -> handler returned).
+void countHandled(MsgType mt) {
+  if (mt == MSG_INVALID) {
+    parseFailures++;
+    return;
+  }
+  rxCount[mt]++;
+  handlerTiming[mt].add(traceNow() - rxTimes.parsed);
+}
+
+// ---------- WebSocket callbacks on core0 ----------
+void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
+  if (type == WStype_CONNECTED) {
+    Serial.println("[WS] connected");
+    wsConnected = true;
+    coalesceOn = false;
+    clockSync.reset();
+    syncSentUs = 0;
+    lastSyncMs = millis() - SYNC_FAST_MS;
+    sendHello();
+
+  } else if (type == WStype_DISCONNECTED) {
+    wsConnected = false;
+    coalesceOn = false;
+
+  } else if (type == WStype_TEXT) {
+    rxAtUs = esp_timer_get_time();
+    rxTimes = CmdTimes{};
+    rxTimes.rx = (uint32_t)rxAtUs;
+    rxSched = BinSched{PRIO_NORMAL, 0};
+    DeserializationError err = ingestJSON(payload, length);
+    if (err) {
+      parseFailures++;
+      if (err == DeserializationError::NoMemory) refuseOversized(payload, length);
+      return;
+    }
+    rxTimes.parsed = traceNow();
+    countHandled(dispatchJSON(rxDoc));
+
+  } else if (type == WStype_BIN) {
+    rxAtUs = esp_timer_get_time();
+    rxTimes = CmdTimes{};
+    rxTimes.rx = rxTimes.parsed = (uint32_t)rxAtUs;  // fixed layout, decoding is a memcpy
+    rxSched = BinSched{PRIO_NORMAL, 0};
+    countHandled(dispatchBIN(payload, length));
+  }
 }
 
-void sendAck(const String &id) {
-  StaticJsonDocument<128> d;
-  d["type"] = "ACK";
-  d["id"] = id;
-  sendJSON(d);
+// ---------- Outbound frames ----------
+// Built in one static buffer (only core0 sends) with room for the WebSocket
+// header in front: no heap per send.
+typedef TxFrame<TX_FRAME_BYTES> TxBuf;
+TxBuf txFrame;
+
+TxBuf &txBegin() {
+  txFrame.clear();
+  return txFrame;
 }
 
-void sendStatus(const String &id, const char* state, const char* error) {
-  StaticJsonDocument<256> d;
-  d["type"] = "STATUS";
-  d["id"] = id;
-  d["state"] = state;
-  d["pan"] = currentPan;
-  d["tilt"] = currentTilt;
-  if (error) d["error"] = error;
-  sendJSON(d);
+void txSend(TxBuf &f, bool bin) {
+  if (f.overflowed()) {
+    Serial.println("[WS TX] frame too large, dropped");
+    return;
+  }
+  if (bin) webSocket.sendBIN(f.payload(), f.length(), true);
+  else webSocket.sendTXT(f.payload(), f.length(), true);
+}
+
+void sendHello() {
+  TxBuf &f = txBegin();
+  f.lit("{\"type\":\"HELLO\",\"node\":\"esp32_sentry\"}");
+  txSend(f, false);
+}
+
+void sendAck(const CmdId &id) {
+  TxBuf &f = txBegin();
+  if (id.bin) {
+    BinIdOnly a;
+    a.op = BIN_ACK;
+    a.id = id.num;
+    f.raw(&a, sizeof(a));
+  } else {
+    f.lit("{\"type\":\"ACK\",\"id\":\"").jstr(id.c_str()).lit("\"}");
+  }
+  txSend(f, id.bin);
+}
+
+// Core0 only; core1 goes through reportStatus().
+void sendStatus(const CmdId &id, CmdState state, CmdError error) {
+  const MotionState ms = motionState.read();
+  sendStatusFrame(id, state, error, ms.pan, ms.tilt, nullptr);
+}
+
+// cmdId (JSON only) names the active command in STATUS_REQ replies;
+// points > 0 adds TRAJECTORY progress.
+void sendStatusFrame(const CmdId &id, CmdState state, CmdError error, int pan, int tilt, const CmdId* cmdId,
+                     uint16_t point, uint16_t points) {
+  TxBuf &f = txBegin();
+  if (id.bin) {
+    BinStatus st;
+    st.op = BIN_STATUS;
+    st.id = id.num;
+    st.state = state;
+    st.error = error;
+    st.pan_cdeg = (int16_t)pan;
+    st.tilt_cdeg = (int16_t)tilt;
+    f.raw(&st, sizeof(st));
+    if (points) {
+      BinStatusProgress p = {point, points};
+      f.raw(&p, sizeof(p));
+    }
+  } else {
+    f.lit("{\"type\":\"STATUS\",\"id\":\"").jstr(id.c_str())
+     .lit("\",\"state\":\"").cstr(stateName(state))
+     .lit("\",\"pan\":").hundredths(pan)
+     .lit(",\"tilt\":").hundredths(tilt);
+    if (cmdId) f.lit(",\"cmd_id\":\"").jstr(cmdId->c_str()).lit("\"");
+    if (error != ERR_NONE) f.lit(",\"error\":\"").cstr(errorName(error)).lit("\"");
+    if (points) f.lit(",\"point\":").num(point).lit(",\"points\":").num(points);
+    f.lit("}");
+  }
+  txSend(f, id.bin);
+}
+
+size_t statusPending() { return statusRing.size(); }
+
+// Sends up to STATUS_BATCH queued core1 events; called from loop().
+void drainStatus() {
+  StatusEvent e;
+  for (size_t n = 0; n < STATUS_BATCH && statusRing.pop(e); n++) {
+    if (!e.silent) sendStatusFrame(e.id, e.state, e.error, e.pan, e.tilt, nullptr, e.point, e.points);
+    if (e.final) traceFinish(e.id, e.op, e.t, e.state, e.error);
+  }
+}
+
+// Streams traceRing oldest-first as BIN_TRACE frames; always binary, no ACK.
+void handleTraceDump() {
+  const size_t perFrame = (TX_FRAME_BYTES - sizeof(BinTraceHdr)) / sizeof(TraceRecord);
+  size_t total = traceRing.size(), i = 0;
+  uint16_t seq = 0;
+  do {
+    size_t n = min(perFrame, total - i);
+    BinTraceHdr h = {BIN_TRACE, seq++, (uint8_t)n, (uint8_t)(i + n == total)};
+    TxBuf &f = txBegin();
+    f.raw(&h, sizeof(h));
+    for (size_t k = 0; k < n; k++) f.raw(&traceRing.at(i + k), sizeof(TraceRecord));
+    txSend(f, true);
+    i += n;
+  } while (i < total);
+}
+
+// Reply to STATS in the format it was asked in; no ACK.
+void handleStats(bool bin) {
+  BinStats st;
+  st.op = BIN_STATS;
+  st.uptime_ms = millis();
+  for (uint8_t t = 0; t < MSG_COUNT; t++) {
+    st.rx[t] = rxCount[t];
+    st.handler_avg_us[t] = handlerTiming[t].avgUs();
+    st.handler_max_us[t] = handlerTiming[t].maxUs;
+  }
+  st.parse_fail = parseFailures;
+  st.queue_full = ringFull + queueFull.get();
+  st.ring_hwm = (uint16_t)ringHighWater.get();
+  st.queue_hwm = (uint16_t)queueHighWater.get();
+  st.preempted = preemptCount.get();
+  st.cancelled = cancelCount.get();
+  st.timeouts = timeoutCount.get();
+  st.expired = expiredCount.get();
+  st.step_overruns = stepOverruns.get();
+  st.status_dropped = statusDropped.get();
+  st.coalesced = coalescedCount.get();
+  st.min_free_heap = ESP.getMinFreeHeap();
+  st.motion_stack_free = motionTask ? uxTaskGetStackHighWaterMark(motionTask) : 0;
+  sendStats(st, bin);
+}
+
+void sendStats(const BinStats &st, bool bin) {
+  TxBuf &f = txBegin();
+  if (bin) {
+    f.raw(&st, sizeof(st));
+  } else {
+    f.lit("{\"type\":\"STATS\",\"uptime_ms\":").u32(st.uptime_ms).lit(",\"rx\":{");
+    for (uint8_t t = 0; t < MSG_COUNT; t++) {
+      if (t) f.lit(",");
+      f.lit("\"").cstr(msgTypeName((MsgType)t)).lit("\":").u32(st.rx[t]);
+    }
+    f.lit("},\"parse_fail\":").u32(st.parse_fail)
+     .lit(",\"queue_full\":").u32(st.queue_full)
+     .lit(",\"ring_hwm\":").u32(st.ring_hwm)
+     .lit(",\"queue_hwm\":").u32(st.queue_hwm)
+     .lit(",\"preempted\":").u32(st.preempted)
+     .lit(",\"cancelled\":").u32(st.cancelled)
+     .lit(",\"timeouts\":").u32(st.timeouts)
+     .lit(",\"expired\":").u32(st.expired)
+     .lit(",\"step_overruns\":").u32(st.step_overruns)
+     .lit(",\"status_dropped\":").u32(st.status_dropped)
+     .lit(",\"coalesced\":").u32(st.coalesced)
+     .lit(",\"min_free_heap\":").u32(st.min_free_heap)
+     .lit(",\"motion_stack_free\":").u32(st.motion_stack_free)
+     .lit(",\"handler_us\":{");
+    for (uint8_t t = 0; t < MSG_COUNT; t++) {
+      if (t) f.lit(",");
+      f.lit("\"").cstr(msgTypeName((MsgType)t)).lit("\":[").u32(st.handler_avg_us[t])
+       .lit(",").u32(st.handler_max_us[t]).lit("]");
+    }
+    f.lit("}}");
+  }
+  txSend(f, bin);
+}
+
+// Echo the server's timestamp with when the PING arrived and when the PONG
+// leaves; the server works out RTT and clock offset. No ACK.
+void handlePing(uint32_t seq, uint64_t serverUs, bool bin) {
+  TxBuf &f = txBegin();
+  if (bin) {
+    BinPong p = {BIN_PONG, seq, serverUs, (uint64_t)rxAtUs, 0};
+    p.tx_us = esp_timer_get_time();
+    f.raw(&p, sizeof(p));
+  } else {
+    f.lit("{\"type\":\"PONG\",\"seq\":").u64(seq)
+     .lit(",\"t\":").u64(serverUs)
+     .lit(",\"rx_us\":").u64(rxAtUs)
+     .lit(",\"tx_us\":").u64(esp_timer_get_time()).lit("}");
+  }
+  txSend(f, bin);
+}
+
+// ---------- Clock sync ----------
+// We start the exchange (JSON, like HELLO); the server answers SYNC in
+// either format. Fast until the window is full, then every SYNC_INTERVAL_MS.
+void syncService() {
+  unsigned long now = millis();
+  unsigned long every = clockSync.count() < ClockSync::WINDOW ? SYNC_FAST_MS : SYNC_INTERVAL_MS;
+  if (!wsConnected || now - lastSyncMs < every) return;
+  lastSyncMs = now;
+
+  TxBuf &f = txBegin();
+  f.lit("{\"type\":\"SYNC_REQ\",\"seq\":").u64(++syncSeq).lit(",\"t\":");
+  syncSentUs = esp_timer_get_time();
+  f.u64(syncSentUs).lit("}");
+  txSend(f, false);
+}
+
+// Only the answer to the latest SYNC_REQ counts; late ones carry stale queueing.
+void handleSync(uint32_t seq, uint64_t t, uint64_t serverRx, uint64_t serverTx) {
+  if (!syncSentUs || seq != syncSeq || (int64_t)t != syncSentUs) return;
+  syncSentUs = 0;
+  bool first = !clockSync.synced();
+  if (clockSync.add((int64_t)t, (int64_t)serverRx, (int64_t)serverTx, rxAtUs) && first) {
+    Serial.printf("[SYNC] offset %lld us, rtt %lu us\n",
+                  (long long)clockSync.offsetUs(), (unsigned long)clockSync.rttUs());
+  }
 }
 
 // ---------- Core1: motion task ----------
-void taskMotion(void* pv) {
-  Serial.println("[MOTION] Started on core " + String(xPortGetCoreID()));
-  unsigned long lastStep = millis();
+// Everything below runs on core1 and is the only writer of the motion state;
+// core0 reaches it through cmdRing.
+// Commands waiting their turn, in the order they will run: higher priority
+// first, then the earliest deadline, then arrival. Mostly queued MOVEs; any
+// motion command the active one outranks waits here too.
+Cmd waiting[CMD_QUEUE_LEN];
+size_t waitingCount = 0;
+Cmd scheduled[CMD_SCHED_LEN];      // execute_at commands, earliest first
+size_t scheduledCount = 0;
+esp_timer_handle_t stepTimer = nullptr;
+esp_timer_handle_t schedTimer = nullptr;  // one-shot, armed for scheduled[0]
+bool stepNow = false;              // a scheduled command just started: step now
+CmdOp activeOp = OP_MOVE;
+CmdTimes activeTimes;              // trace of the active command
 
-  servoPan.write(currentPan);
-  servoTilt.write(currentTilt);
+// Step-timer jitter: wake-to-wake interval minus STEP_INTERVAL_US, per
+// JITTER_LOG_MS window. overruns counts intervals over 1.5 periods (a step
+// was late enough to merge with the next one).
+struct StepJitter {
+  uint32_t steps;
+  int32_t minUs;
+  int32_t maxUs;
+  uint64_t sumAbsUs;
+  uint32_t overruns;
+};
+StepJitter stepJitter = {0, 0, 0, 0, 0};
+int64_t lastStepUs = 0;
+unsigned long lastJitterLog = 0;
 
-  while (true) {
-    unsigned long now = millis();
+// Called after every change to the motion state, before any STATUS that
+// should reflect it.
+void publishMotion() {
+  motionState.write(MotionState{activeCmdId, q16ToCdeg(currentPan), q16ToCdeg(currentTilt), activeMode, hasActive});
+}
+
+// Queues a STATUS for core0; never blocks. Reports the current position.
+// `t` marks the command's last event: core0 files its trace after sending.
+void reportStatus(const CmdId &id, CmdState state, CmdError error = ERR_NONE,
+                  CmdOp op = OP_MOVE, const CmdTimes *t = nullptr, bool silent = false) {
+  StatusEvent e = {id, state, error, q16ToCdeg(currentPan), q16ToCdeg(currentTilt),
+                   t != nullptr, silent, op, t ? *t : CmdTimes{}, 0, 0};
+  if (!statusRing.push(e)) statusDropped.inc();
+  if (t && !silent) {
+    if (state == ST_PREEMPTED) preemptCount.inc();
+    else if (state == ST_CANCELLED) cancelCount.inc();
+    else if (state == ST_TIMEOUT) timeoutCount.inc();
+    else if (state == ST_EXPIRED) expiredCount.inc();
+  }
+}
+
+// TRAJECTORY progress for the active command; not its last event.
+void reportProgress(CmdState state) {
+  StatusEvent e = {activeCmdId, state, ERR_NONE, q16ToCdeg(currentPan), q16ToCdeg(currentTilt),
+                   false, false, activeOp, CmdTimes{}, (uint16_t)trajNext, (uint16_t)trajCount};
+  if (!statusRing.push(e)) statusDropped.inc();
+}
+
+void finishCmd(const Cmd &c, CmdState state, CmdError error = ERR_NONE, bool silent = false) {
+  reportStatus(c.id, state, error, c.op, &c.t, silent);
+}
+
+// Pulse for one axis, written only if it changed; true if written.
+bool writeAxis(Servo &s, const ServoCal &cal, q16_t deg, int &lastUs) {
+  const int us = cal.pulseUs(deg);
+  if (us == lastUs) return false;
+  lastUs = us;
+  s.writeMicroseconds(us);
+  return true;
+}
+
+bool writeServos() {
+  bool wrote = writeAxis(servoPan, PAN_CAL, currentPan, panUs);
+  wrote |= writeAxis(servoTilt, TILT_CAL, currentTilt, tiltUs);
+  return wrote;
+}
+
+void markFirstWrite() {
+  if (!activeTimes.firstWrite) activeTimes.firstWrite = traceNow();
+}
+
+void endActive(CmdState state, bool silent = false) {
+  reportStatus(activeCmdId, state, ERR_NONE, activeOp, &activeTimes, silent);
+  hasActive = false; activeCmdId = CmdId::none(); activeMode = 0; onPath = false; activeLease = false;
+  velPan = velTilt = velPanCmd = velTiltCmd = 0;
+  publishMotion();
+}
+
+bool dropFrom(Cmd* q, size_t &count, const CmdId &id, Cmd &dropped) {
+  for (size_t i = 0; i < count; i++) {
+    if (q[i].id == id) {
+      dropped = q[i];
+      memmove(&q[i], &q[i + 1], (count - i - 1) * sizeof(Cmd));
+      count--;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Wake the task when scheduled[0] is due (the step timer alone would
+// start it up to a full period late).
+void armSchedTimer() {
+  if (!schedTimer) return;
+  esp_timer_stop(schedTimer);
+  if (scheduledCount == 0) return;
+  int64_t wait = scheduled[0].startUs - esp_timer_get_time();
+  esp_timer_start_once(schedTimer, wait > 0 ? (uint64_t)wait : 1);
+}
+
+// Holds a future execute_at command until it is due.
+void schedule(const Cmd &c) {
+  if (scheduledCount == CMD_SCHED_LEN) {
+    queueFull.inc();
+    finishCmd(c, ST_ERROR, ERR_QUEUE_FULL);
+    return;
+  }
+  size_t i = scheduledCount;
+  while (i > 0 && scheduled[i - 1].startUs > c.startUs) {
+    scheduled[i] = scheduled[i - 1];
+    i--;
+  }
+  scheduled[i] = c;
+  scheduledCount++;
+  if (i == 0) armSchedTimer();
+}
+
+// A deadline is for starting: a command still waiting at its deadline is
+// dropped with EXPIRED, one that got going runs to the end.
+bool expired(const Cmd &c, int64_t nowUs) { return c.deadlineUs && nowUs > c.deadlineUs; }
+
+void expire(const Cmd &c) {
+  if (c.op == OP_TRAJECTORY) trajUpload.release();
+  finishCmd(c, ST_EXPIRED);
+}
+
+// Drops every command in q past its deadline; true if any went.
+bool expireFrom(Cmd* q, size_t &count, int64_t nowUs) {
+  size_t kept = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (expired(q[i], nowUs)) expire(q[i]);
+    else q[kept++] = q[i];
+  }
+  const bool any = kept != count;
+  count = kept;
+  return any;
+}
+
+// Run order of the waiting list (EDF within a priority class)
+bool runsBefore(const Cmd &a, const Cmd &b) {
+  if (a.priority != b.priority) return a.priority > b.priority;
+  return (a.deadlineUs ? a.deadlineUs : INT64_MAX) < (b.deadlineUs ? b.deadlineUs : INT64_MAX);
+}
+
+q16_t clampAbs(q16_t v, uint64_t limit) {
+  return v > (int64_t)limit ? (q16_t)limit : v < -(int64_t)limit ? -(q16_t)limit : v;
+}
 
-    // pick next absolute command if idle
-    if (!hasActive) {
-      noInterrupts();
-      if (!cmdQueue.empty()) {
-        Cmd c = cmdQueue.front();
-        cmdQueue.pop_front();
-        hasActive = true;
-        activeCmdId = c.id;
-        activeMode = 1;
-        targetPan = c.pan;
-        targetTilt = max(c.tilt, TILT_MIN_SAFE); // enforce safe tilt
+q16_t slewTo(q16_t v, q16_t target, uint64_t maxDelta) {
+  return target > v ? v + clampAbs(target - v, maxDelta) : v - clampAbs(v - target, maxDelta);
+}
+
+// Modes driven through velPan/velTilt
+bool velocityDriven(uint8_t mode) { return mode == 2 || mode == 3 || mode == 5; }
+
+// Preempts whatever runs and makes `c` the active velocity-driven command
+// (mode 2, 3 or 5). From one such command to the next the servos keep their
+// speed.
+void takeOverVelocity(const Cmd &c, uint8_t mode, unsigned long now, unsigned long timeoutMs) {
+  const bool wasVelocity = hasActive && velocityDriven(activeMode);
+  const q16_t keepPan = velPan, keepTilt = velTilt;
+  if (hasActive) endActive(ST_PREEMPTED);
+  if (wasVelocity) {
+    velPan = keepPan; velTilt = keepTilt;
+  }
+  hasActive = true;
+  activeCmdId = c.id;
+  activeMode = mode;
+  activePriority = c.priority;
+  activeOp = c.op;
+  activeTimes = c.t;
+  cmdStartMillis = now;
+  activeTimeoutMs = timeoutMs;
+}
+
+// MOVE_DIR (degrees per step) and MOVE_VEL (centidegrees per second) both
+// become a Q16 per-step velocity, capped by the axis limits. A velocity
+// command carrying the active one's id updates it in place: new velocity,
+// timeout restarted, no PREEMPTED/MOVING (its trace record is silent).
+void startVelocity(const Cmd &c, unsigned long now) {
+  q16_t panV, tiltV;
+  if (c.op == OP_MOVE_DIR) {
+    panV = c.panDir * degToQ16(c.speed);
+    tiltV = c.tiltDir * degToQ16(c.speed);
+  } else {
+    panV = (q16_t)((int64_t)c.panVel * Q16_ONE * (int64_t)STEP_INTERVAL_US / 100000000);
+    tiltV = (q16_t)((int64_t)c.tiltVel * Q16_ONE * (int64_t)STEP_INTERVAL_US / 100000000);
+  }
+  panV = clampAbs(panV, velPerStep(PAN_LIMITS, STEP_INTERVAL_US));
+  tiltV = clampAbs(tiltV, velPerStep(TILT_LIMITS, STEP_INTERVAL_US));
+
+  const unsigned long timeoutMs = c.leaseMs ? min((unsigned long)c.leaseMs, COMMAND_TIMEOUT_MS) : COMMAND_TIMEOUT_MS;
+  if (hasActive && activeMode == 2 && activeCmdId == c.id) {
+    velPanCmd = panV; velTiltCmd = tiltV;
+    cmdStartMillis = now;
+    activeTimeoutMs = timeoutMs;
+    activeLease = c.leaseMs != 0;
+    finishCmd(c, ST_MOVING, ERR_NONE, true);
+    return;
+  }
+
+  takeOverVelocity(c, 2, now, timeoutMs);
+  activeLease = c.leaseMs != 0;
+  velPanCmd = panV; velTiltCmd = tiltV;
+  publishMotion();
+  reportStatus(c.id, ST_MOVING);
+}
+
+// TRACK_ERR: the error belongs to the pose at frame time, pose + error is a
+// measurement of the target for the predictor. The same id feeds the
+// running loop (silent trace record); a new id preempts as usual.
+void startTrack(const Cmd &c, unsigned long now) {
+  q16_t panAt = currentPan, tiltAt = currentTilt;
+  poseHistory.at(c.frameUs, panAt, tiltAt);
+
+  if (!(hasActive && activeMode == 3 && activeCmdId == c.id)) {
+    takeOverVelocity(c, 3, now, TRACK_HOLD_MS + TRACK_DECAY_MS);
+    trackPan.reset();
+    trackTilt.reset();
+    reportStatus(c.id, ST_MOVING);
+  } else {
+    cmdStartMillis = now;
+    finishCmd(c, ST_MOVING, ERR_NONE, true);
+  }
+  trackPan.update(panAt + c.panErr, c.frameUs, TRACK_GAINS);
+  trackTilt.update(tiltAt + c.tiltErr, c.frameUs, TRACK_GAINS);
+  publishMotion();
+}
+
+// Velocity commands for this step: toward the predicted target, at full
+// gain for TRACK_HOLD_MS after the last frame, then fading out over
+// TRACK_DECAY_MS.
+void trackStep(unsigned long now) {
+  const int64_t nowUs = esp_timer_get_time();
+  const unsigned long since = now - cmdStartMillis;
+  int64_t scale = Q16_ONE;
+  if (since >= TRACK_HOLD_MS + TRACK_DECAY_MS) scale = 0;
+  else if (since > TRACK_HOLD_MS) scale = (int64_t)(TRACK_HOLD_MS + TRACK_DECAY_MS - since) * Q16_ONE / TRACK_DECAY_MS;
+  const int64_t panV = trackPan.velocity(currentPan, nowUs, TRACK_GAINS, STEP_INTERVAL_US);
+  const int64_t tiltV = trackTilt.velocity(currentTilt, nowUs, TRACK_GAINS, STEP_INTERVAL_US);
+  velPanCmd = clampAbs((q16_t)(panV * scale >> 16), velPerStep(PAN_LIMITS, STEP_INTERVAL_US));
+  velTiltCmd = clampAbs((q16_t)(tiltV * scale >> 16), velPerStep(TILT_LIMITS, STEP_INTERVAL_US));
+}
+
+// TRAJECTORY takes over at once, like a velocity command; it has no
+// execute_at. Timeout: the schedule plus half again, as for a MOVE.
+void startTrajectory(const Cmd &c, unsigned long now) {
+  trajUpload.takeInto(trajRun, c.points);
+  if (hasActive) endActive(ST_PREEMPTED);
+  hasActive = true;
+  activeCmdId = c.id;
+  activeMode = 4;
+  activePriority = c.priority;
+  activeOp = c.op;
+  activeTimes = c.t;
+  cmdStartMillis = now;
+  trajCount = c.points; trajNext = 0; trajUs = 0;
+  trajFromPan = currentPan; trajFromTilt = currentTilt;
+  reportEveryMs = c.reportMs; reportedAt = now;
+  const unsigned long totalMs = trajRun[trajCount - 1].tMs;
+  activeTimeoutMs = totalMs + totalMs / 2 + MOVE_TIMEOUT_SLACK_MS;
+  publishMotion();
+  reportProgress(ST_MOVING);
+  Serial.printf("[MOTION] New TRAJECTORY id=%s, %u points (%lu ms)\n", c.id.c_str(), c.points, totalMs);
+}
+
+// One step along the trajectory: the point on the schedule at the end of
+// this step, linear between waypoints, reached at no more than the axis
+// velocity limit (a schedule the servos can't keep falls behind and
+// catches up on the slower stretches).
+void trajectoryStep(unsigned long now) {
+  trajUs += STEP_INTERVAL_US;
+  while (trajNext < trajCount && trajUs >= (uint64_t)trajRun[trajNext].tMs * 1000) trajNext++;
+  const TrajPoint &last = trajRun[trajCount - 1];
+  q16_t wantPan = cdegToQ16(last.pan), wantTilt = cdegToQ16(last.tilt);
+  if (trajNext < trajCount) {
+    const TrajPoint &to = trajRun[trajNext];
+    q16_t fromPan = trajFromPan, fromTilt = trajFromTilt;
+    uint64_t fromUs = 0;
+    if (trajNext > 0) {
+      const TrajPoint &from = trajRun[trajNext - 1];
+      fromPan = cdegToQ16(from.pan); fromTilt = cdegToQ16(from.tilt);
+      fromUs = (uint64_t)from.tMs * 1000;
+    }
+    const int64_t span = (int64_t)to.tMs * 1000 - (int64_t)fromUs, into = (int64_t)(trajUs - fromUs);
+    wantPan = fromPan + (q16_t)((int64_t)(cdegToQ16(to.pan) - fromPan) * into / span);
+    wantTilt = fromTilt + (q16_t)((int64_t)(cdegToQ16(to.tilt) - fromTilt) * into / span);
+  }
+  currentPan = slewTo(currentPan, wantPan, velPerStep(PAN_LIMITS, STEP_INTERVAL_US));
+  currentTilt = slewTo(currentTilt, wantTilt, velPerStep(TILT_LIMITS, STEP_INTERVAL_US));
+  if (writeServos()) markFirstWrite();
+  publishMotion();
+
+  if (trajNext == trajCount && currentPan == wantPan && currentTilt == wantTilt) {
+    endActive(ST_SUCCESS);
+  } else if (now - cmdStartMillis > activeTimeoutMs) {
+    endActive(ST_TIMEOUT);
+  } else if (reportEveryMs && now - reportedAt >= reportEveryMs) {
+    reportedAt = now;
+    reportProgress(ST_MOVING);
+  }
+}
+
+// A coalesced MOVE: the first one takes over like a velocity command and
+// reports MOVING; later ones only move the target, and the one they replace
+// gets a silent PREEMPTED trace record.
+void startLatest(const Cmd &c, unsigned long now) {
+  if (hasActive && activeMode == 5) {
+    reportStatus(activeCmdId, ST_PREEMPTED, ERR_NONE, activeOp, &activeTimes, true);
+    activeCmdId = c.id;
+    activeTimes = c.t;
+    cmdStartMillis = now;
+  } else {
+    takeOverVelocity(c, 5, now, COMMAND_TIMEOUT_MS);
+    reportEveryMs = c.reportMs; reportedAt = now;
+    reportStatus(c.id, ST_MOVING);
+  }
+  latestPan = cdegToQ16(c.pan);
+  latestTilt = cdegToQ16(c.tilt);
+  publishMotion();
+}
+
+// Takes the newest coalesced MOVE if it is new and was sent no later than
+// the cmdRing command about to run (latestSeq <= upTo). Targets it
+// overwrote on core0 never got here; they are only counted. While a
+// higher-priority command runs the target stays where it is.
+void takeLatest(unsigned long now, uint32_t upTo) {
+  if (latestSeen == upTo || (hasActive && activePriority > PRIO_NORMAL)) return;
+  Cmd c = latestMove.read();
+  if (c.latestSeq == latestSeen || c.latestSeq > upTo) return;
+  coalescedCount.add(c.latestSeq - latestSeen - 1);
+  latestSeen = c.latestSeq;
+  c.t.dequeued = traceNow();
+  startLatest(c, now);
+}
+
+// One axis of latest mode: velocity slews toward the fastest approach that
+// can still stop on the target; the step that would reach it lands on it.
+void latestAxis(q16_t &pos, q16_t &vel, q16_t target, const AxisLimits &lim) {
+  vel = slewTo(vel, approachVelocity(target - pos, lim, STEP_INTERVAL_US), accPerStep(lim, STEP_INTERVAL_US));
+  const q16_t err = target - pos;
+  if ((vel > 0 && vel >= err && err >= 0) || (vel < 0 && vel <= err && err <= 0)) {
+    pos = target;
+    vel = 0;
+  } else {
+    pos += vel;
+  }
+}
+
+void latestStep(unsigned long now) {
+  latestAxis(currentPan, velPan, latestPan, PAN_LIMITS);
+  latestAxis(currentTilt, velTilt, latestTilt, TILT_LIMITS);
+  if (writeServos()) markFirstWrite();
+  publishMotion();
+
+  if (currentPan == latestPan && currentTilt == latestTilt && !velPan && !velTilt &&
+      now - cmdStartMillis >= LATEST_SETTLE_MS) {
+    endActive(ST_SUCCESS);
+  } else if (now - cmdStartMillis > activeTimeoutMs) {
+    endActive(ST_TIMEOUT);
+  } else if (reportEveryMs && now - reportedAt >= reportEveryMs) {
+    reportedAt = now;
+    reportStatus(activeCmdId, ST_MOVING);
+  }
+}
+
+uint32_t durationSteps(const Cmd &c) {
+  return (uint32_t)(((uint64_t)c.durationMs * 1000 + STEP_INTERVAL_US - 1) / STEP_INTERVAL_US);
+}
+
+// Exit speed for the active path segment: the waypoints queued right
+// behind it, up to the first MOVE that isn't queued. The segment list
+// (~680 B) is static rather than on MotionTask's 4 KB stack.
+PathSeg pathSegs[CMD_QUEUE_LEN + 1];
+
+void planPath() {
+  if (!hasActive || activeMode != 1 || !onPath) return;
+  PathSeg *segs = pathSegs;
+  size_t n = 0;
+  segs[n++] = path.seg;
+  for (size_t i = 0; i < waitingCount && waiting[i].queued; i++) {
+    const PathSeg &prev = segs[n - 1];
+    const Cmd &c = waiting[i];
+    segs[n++].init(prev.startPan + prev.distPan, prev.startTilt + prev.distTilt, cdegToQ16(c.pan),
+                   cdegToQ16(max((int)c.tilt, TILT_MIN_SAFE * 100)), PAN_LIMITS, TILT_LIMITS,
+                   STEP_INTERVAL_US, durationSteps(c));
+  }
+  path.exit = planExitSpeed(segs, n, PAN_LIMITS, TILT_LIMITS, STEP_INTERVAL_US, CORNER_JUMP_US);
+}
+
+// Whether c starts at once instead of waiting its turn: it outranks what
+// runs, or ties it and isn't a queued MOVE (those wait for the MOVE or path
+// ahead, not for a velocity command). With nothing running it is up against
+// the head of the waiting list. The active command's id is an update to it.
+bool startsNow(const Cmd &c) {
+  uint8_t against;
+  bool queueBehind;
+  if (hasActive) {
+    if (activeCmdId == c.id) return true;
+    against = activePriority;
+    queueBehind = !velocityDriven(activeMode);
+  } else if (waitingCount > 0) {
+    against = waiting[0].priority;
+    queueBehind = true;
+  } else {
+    return true;
+  }
+  if (c.priority != against) return c.priority > against;
+  return !(queueBehind && c.op == OP_MOVE && c.queued && !c.startUs);
+}
+
+// Puts c in the waiting list behind everything that runs before it. A
+// velocity or TRACK command replaces one waiting under its id (silent
+// PREEMPTED trace record for that one).
+void enqueue(const Cmd &c) {
+  Cmd old;
+  if (c.op != OP_MOVE && dropFrom(waiting, waitingCount, c.id, old)) finishCmd(old, ST_PREEMPTED, ERR_NONE, true);
+  if (waitingCount == CMD_QUEUE_LEN) {
+    queueFull.inc();
+    finishCmd(c, ST_ERROR, ERR_QUEUE_FULL);
+    return;
+  }
+  size_t i = waitingCount;
+  while (i > 0 && runsBefore(c, waiting[i - 1])) {
+    waiting[i] = waiting[i - 1];
+    i--;
+  }
+  waiting[i] = c;
+  waitingCount++;
+  queueHighWater.raiseTo(waitingCount);
+  planPath();   // the path may now pass the active waypoint faster
+}
+
+// Preempts whatever runs and starts an absolute MOVE. A queued one following
+// a path segment takes over its speed `v` with `over` of its length already
+// covered.
+void startMove(const Cmd &c, unsigned long now, int64_t v = 0, int64_t over = 0) {
+  if (hasActive) endActive(ST_PREEMPTED);
+  hasActive = true;
+  activeCmdId = c.id;
+  activeMode = 1;
+  activePriority = c.priority;
+  activeOp = c.op;
+  activeTimes = c.t;
+  cmdStartMillis = now;
+  int tilt = max((int)c.tilt, TILT_MIN_SAFE * 100); // enforce safe tilt
+  panMove.start = currentPan;
+  panMove.dist = cdegToQ16(c.pan) - panMove.start;
+  tiltMove.start = currentTilt;
+  tiltMove.dist = cdegToQ16(tilt) - tiltMove.start;
+  const uint32_t minSteps = durationSteps(c);
+  // a path segment runs faster than this (trapezoid from rest), but it
+  // bounds the timeout all the same
+  const ProfileShape shape = c.queued ? PROFILE_TRAPEZOID : MOTION_PROFILE;
+  ProfileNeed need;
+  need.add(panMove.dist, PAN_LIMITS, shape, STEP_INTERVAL_US);
+  need.add(tiltMove.dist, TILT_LIMITS, shape, STEP_INTERVAL_US);
+  movePlan = planProfile(need, shape, minSteps);
+  moveStep = 0;
+  unsigned long planMs = (unsigned long)((uint64_t)movePlan.steps() * STEP_INTERVAL_US / 1000);
+  activeTimeoutMs = planMs + planMs / 2 + MOVE_TIMEOUT_SLACK_MS;
+  onPath = c.queued;
+  if (onPath) {
+    path.seg.init(currentPan, currentTilt, cdegToQ16(c.pan), cdegToQ16(tilt), PAN_LIMITS, TILT_LIMITS,
+                  STEP_INTERVAL_US, minSteps);
+    path.s = over < path.seg.len ? over : path.seg.len;
+    path.v = v;
+    planPath();
+  }
+  publishMotion();
+  Serial.printf("[MOTION] New ABS cmd id=%s pan=%.2f tilt=%.2f, %lu steps (%lu ms)%s\n", c.id.c_str(),
+                c.pan / 100.0, c.tilt / 100.0,
+                (unsigned long)movePlan.steps(), planMs, onPath ? ", on path" : "");
+}
+
+void startCmd(const Cmd &c, unsigned long now, int64_t v = 0, int64_t over = 0) {
+  switch (c.op) {
+    case OP_MOVE: startMove(c, now, v, over); break;
+    case OP_MOVE_DIR:
+    case OP_MOVE_VEL: startVelocity(c, now); break;
+    case OP_TRACK_ERR: startTrack(c, now); break;
+    case OP_TRAJECTORY: startTrajectory(c, now); break;
+    default: break;
+  }
+}
+
+// Starts the first waiting command still within its deadline; `v`/`over`
+// as for startMove, for the head of the list only.
+void startNext(unsigned long now, int64_t v = 0, int64_t over = 0) {
+  while (waitingCount > 0) {
+    const Cmd c = waiting[0];
+    memmove(&waiting[0], &waiting[1], (waitingCount - 1) * sizeof(Cmd));
+    waitingCount--;
+    if (!expired(c, esp_timer_get_time())) {
+      startCmd(c, now, v, over);
+      return;
+    }
+    expire(c);
+    v = over = 0;
+  }
+}
+
+// Runs a command now; future execute_at ones have gone to schedule() first.
+// A motion command past its deadline never starts; one that doesn't start
+// at once waits its turn, except a TRAJECTORY (its upload buffer can't be
+// held up).
+void applyCmd(Cmd c, unsigned long now) {
+  switch (c.op) {
+    case OP_MOVE:
+    case OP_MOVE_DIR:
+    case OP_MOVE_VEL:
+    case OP_TRACK_ERR:
+    case OP_TRAJECTORY:
+      if (expired(c, esp_timer_get_time())) {
+        expire(c);
+      } else if (startsNow(c)) {
+        startCmd(c, now);
+      } else if (c.op == OP_TRAJECTORY) {
+        trajUpload.release();
+        finishCmd(c, ST_ERROR, ERR_BUSY);
+      } else {
+        enqueue(c);
+      }
+      break;
+
+    // STOP/CANCEL get a trace record of their own; it is silent when the
+    // STATUS already went out under the command they ended.
+    case OP_STOP:
+      if (hasActive && (c.id.empty() || activeCmdId == c.id)) {
+        endActive(ST_STOPPED, true);
+        finishCmd(c, ST_STOPPED);
+      } else {
+        finishCmd(c, ST_ERROR, ERR_NOT_ACTIVE);
+      }
+      break;
+
+    // renews a lease that hasn't lapsed yet; anything else is ignored
+    case OP_KEEPALIVE:
+      if (hasActive && activeLease && activeCmdId == c.id && now - cmdStartMillis <= activeTimeoutMs) {
         cmdStartMillis = now;
-        cancelFlag = false;
-        preemptFlag = false;
-        panDir = 0;
-        tiltDir = 0;
-        Serial.printf("[MOTION] New ABS cmd id=%s pan=%d tilt=%d\n", c.id.c_str(), c.pan, c.tilt);
       }
-      interrupts();
+      break;
+
+    case OP_CANCEL: {
+      Cmd dropped;
+      if (hasActive && activeCmdId == c.id) {
+        endActive(ST_CANCELLED);
+        finishCmd(c, ST_CANCELLED, ERR_NONE, true);
+      } else if (dropFrom(waiting, waitingCount, c.id, dropped)) {
+        planPath();
+        finishCmd(dropped, ST_CANCELLED);
+        finishCmd(c, ST_CANCELLED, ERR_NONE, true);
+      } else if (dropFrom(scheduled, scheduledCount, c.id, dropped)) {
+        armSchedTimer();
+        finishCmd(dropped, ST_CANCELLED);
+        finishCmd(c, ST_CANCELLED, ERR_NONE, true);
+      } else {
+        finishCmd(c, ST_ERROR, ERR_NOT_ACTIVE);
+      }
+      break;
     }
+  }
+}
 
-    if (now - lastStep >= STEP_INTERVAL_MS) {
-      lastStep = now;
-
-      // --- Directional motion ---
-      if (hasActive && activeMode == 2) {
-        if (panDir != 0) {
-          int nextPan = currentPan + panDir * moveSpeed;
-          nextPan = constrain(nextPan, PAN_MIN, PAN_MAX);
-          if (nextPan != currentPan) {
-            currentPan = nextPan;
-            servoPan.write(currentPan);
-          }
-        }
-        if (tiltDir != 0) {
-          int nextTilt = currentTilt + tiltDir * moveSpeed;
-          nextTilt = max(nextTilt, TILT_MIN_SAFE);
-          nextTilt = constrain(nextTilt, TILT_MIN, TILT_MAX);
-          if (nextTilt != currentTilt) {
-            currentTilt = nextTilt;
-            servoTilt.write(currentTilt);
-          }
-        }
+// Applies whatever core0 pushed, drops what waited past its deadline and
+// starts the next waiting command; runs on every wakeup so commands don't
+// wait for the next step.
+void motionService(unsigned long now) {
+  Cmd c;
+  ringHighWater.raiseTo(cmdRing.size());
+  while (cmdRing.pop(c)) {
+    takeLatest(now, c.latestSeq);   // a target sent before c goes first
+    c.t.dequeued = traceNow();
+    if (c.startUs > esp_timer_get_time()) schedule(c);
+    else applyCmd(c, now);
+  }
 
-        if (cancelFlag) {
-          sendStatus(activeCmdId, "CANCELLED", nullptr);
-          noInterrupts();
-          hasActive = false; activeCmdId = ""; activeMode = 0;
-          cancelFlag = false; panDir = 0; tiltDir = 0;
-          interrupts();
-        } else if (preemptFlag) {
-          sendStatus(activeCmdId, "PREEMPTED", nullptr);
-          noInterrupts();
-          hasActive = false; activeCmdId = ""; activeMode = 0;
-          preemptFlag = false; panDir = 0; tiltDir = 0;
-          interrupts();
-        } else if (now - cmdStartMillis > COMMAND_TIMEOUT_MS) {
-          sendStatus(activeCmdId, "TIMEOUT", nullptr);
-          noInterrupts();
-          hasActive = false; activeCmdId = ""; activeMode = 0;
-          panDir = 0; tiltDir = 0;
-          interrupts();
-        }
+  // start scheduled commands that are due
+  if (scheduledCount > 0 && scheduled[0].startUs <= esp_timer_get_time()) {
+    while (scheduledCount > 0 && scheduled[0].startUs <= esp_timer_get_time()) {
+      c = scheduled[0];
+      memmove(&scheduled[0], &scheduled[1], (scheduledCount - 1) * sizeof(Cmd));
+      scheduledCount--;
+      applyCmd(c, now);
+    }
+    armSchedTimer();
+    stepNow = true;
+  }
+  takeLatest(now, UINT32_MAX);
 
-      // --- Absolute motion ---
-      } else if (hasActive && activeMode == 1) {
-        if (fabs(targetPan - currentPan) > 0.01f) {
-          if (targetPan > currentPan) currentPan += min(STEP_SIZE, (int)ceil(targetPan - currentPan));
-          else currentPan -= min(STEP_SIZE, (int)ceil(currentPan - targetPan));
-          currentPan = constrain(currentPan, PAN_MIN, PAN_MAX);
-          servoPan.write(currentPan);
-        }
-        if (fabs(targetTilt - currentTilt) > 0.01f) {
-          if (targetTilt > currentTilt) currentTilt += min(STEP_SIZE, (int)ceil(targetTilt - currentTilt));
-          else currentTilt -= min(STEP_SIZE, (int)ceil(currentTilt - targetTilt));
-          currentTilt = max(currentTilt, TILT_MIN_SAFE);
-          currentTilt = constrain(currentTilt, TILT_MIN, TILT_MAX);
-          servoTilt.write(currentTilt);
-        }
+  const int64_t nowUs = esp_timer_get_time();
+  if (expireFrom(waiting, waitingCount, nowUs)) planPath();
+  if (expireFrom(scheduled, scheduledCount, nowUs)) armSchedTimer();
+  if (!hasActive && waitingCount > 0) startNext(now);
+}
 
-        bool panReached = (abs(currentPan - (int)round(targetPan)) <= 0);
-        bool tiltReached = (abs(currentTilt - (int)round(targetTilt)) <= 0);
-
-        if (cancelFlag) {
-          sendStatus(activeCmdId, "CANCELLED", nullptr);
-          noInterrupts(); hasActive = false; activeCmdId = ""; activeMode = 0; cancelFlag = false; interrupts();
-        } else if (preemptFlag) {
-          sendStatus(activeCmdId, "PREEMPTED", nullptr);
-          noInterrupts(); hasActive = false; activeCmdId = ""; activeMode = 0; preemptFlag = false; interrupts();
-        } else if (panReached && tiltReached) {
-          sendStatus(activeCmdId, "SUCCESS", nullptr);
-          noInterrupts(); hasActive = false; activeCmdId = ""; activeMode = 0; interrupts();
-        } else if (now - cmdStartMillis > COMMAND_TIMEOUT_MS) {
-          sendStatus(activeCmdId, "TIMEOUT", nullptr);
-          noInterrupts(); hasActive = false; activeCmdId = ""; activeMode = 0; interrupts();
-        }
+// One servo step; runs once per step-timer period.
+void motionStep(unsigned long now) {
+  // --- Velocity motion (MOVE_DIR / MOVE_VEL / TRACK) ---
+  if (hasActive && (activeMode == 2 || activeMode == 3)) {
+    const bool lapsed = now - cmdStartMillis > activeTimeoutMs;
+    if (activeMode == 3) trackStep(now);
+    if (lapsed && activeLease) velPanCmd = velTiltCmd = 0;   // lease lapsed: brake
+    // velocity slews toward the command within the accel limit; position
+    // stops at the travel limits (tilt never below TILT_MIN_SAFE)
+    velPan = slewTo(velPan, velPanCmd, accPerStep(PAN_LIMITS, STEP_INTERVAL_US));
+    velTilt = slewTo(velTilt, velTiltCmd, accPerStep(TILT_LIMITS, STEP_INTERVAL_US));
+    currentPan = constrain(currentPan + velPan, degToQ16(PAN_MIN), degToQ16(PAN_MAX));
+    currentTilt = constrain(currentTilt + velTilt, degToQ16(max(TILT_MIN, TILT_MIN_SAFE)), degToQ16(TILT_MAX));
+    if (writeServos()) markFirstWrite();
+    publishMotion();
+
+    if (lapsed && !(activeLease && (velPan || velTilt))) endActive(ST_TIMEOUT);
+
+  // --- Queued MOVEs: blended path ---
+  } else if (hasActive && activeMode == 1 && onPath) {
+    int64_t over;
+    const bool done = path.step(over);
+    currentPan = constrain(path.seg.panAt(path.s), degToQ16(PAN_MIN), degToQ16(PAN_MAX));
+    currentTilt = constrain(path.seg.tiltAt(path.s), degToQ16(max(TILT_MIN, TILT_MIN_SAFE)), degToQ16(TILT_MAX));
+    if (done) {
+      // through the waypoint: the next queued MOVE carries on from here at
+      // the same speed, this step's leftover distance included
+      const int64_t v = path.exit ? path.v : 0;
+      endActive(ST_SUCCESS);
+      if (v && waitingCount > 0 && waiting[0].queued) startNext(now, v, over);
+      if (onPath) {
+        currentPan = constrain(path.seg.panAt(path.s), degToQ16(PAN_MIN), degToQ16(PAN_MAX));
+        currentTilt = constrain(path.seg.tiltAt(path.s), degToQ16(max(TILT_MIN, TILT_MIN_SAFE)),
+                                degToQ16(TILT_MAX));
       }
     }
-    vTaskDelay(1);
+    if (writeServos()) markFirstWrite();
+    publishMotion();
+    if (hasActive && now - cmdStartMillis > activeTimeoutMs) endActive(ST_TIMEOUT);
+
+  // --- Coalesced MOVEs: newest target ---
+  } else if (hasActive && activeMode == 5) {
+    latestStep(now);
+
+  // --- Uploaded trajectory ---
+  } else if (hasActive && activeMode == 4) {
+    trajectoryStep(now);
+
+  // --- Absolute motion ---
+  } else if (hasActive && activeMode == 1) {
+    moveStep++;
+    currentPan = constrain(panMove.at(movePlan, moveStep), degToQ16(PAN_MIN), degToQ16(PAN_MAX));
+    currentTilt = constrain(tiltMove.at(movePlan, moveStep), degToQ16(max(TILT_MIN, TILT_MIN_SAFE)),
+                            degToQ16(TILT_MAX));
+    if (writeServos()) markFirstWrite();
+    publishMotion();
+
+    if (moveStep >= movePlan.steps()) endActive(ST_SUCCESS);
+    else if (now - cmdStartMillis > activeTimeoutMs) endActive(ST_TIMEOUT);
+  }
+  poseHistory.add(esp_timer_get_time(), currentPan, currentTilt);
+}
+
+void recordStepJitter(int64_t nowUs) {
+  if (lastStepUs != 0) {
+    int32_t err = (int32_t)(nowUs - lastStepUs - (int64_t)STEP_INTERVAL_US);
+    StepJitter &j = stepJitter;
+    if (j.steps == 0 || err < j.minUs) j.minUs = err;
+    if (j.steps == 0 || err > j.maxUs) j.maxUs = err;
+    j.sumAbsUs += err < 0 ? -err : err;
+    if (err > (int32_t)(STEP_INTERVAL_US / 2)) {
+      j.overruns++;
+      stepOverruns.inc();
+    }
+    j.steps++;
+  }
+  lastStepUs = nowUs;
+
+  unsigned long now = millis();
+  if (JITTER_LOG_MS && now - lastJitterLog >= JITTER_LOG_MS) {
+    const StepJitter &j = stepJitter;
+    if (j.steps) {
+      Serial.printf("[MOTION] step jitter over %lu steps: min %ld us, max %ld us, mean |err| %lu us, %lu overruns\n",
+                    (unsigned long)j.steps, (long)j.minUs, (long)j.maxUs,
+                    (unsigned long)(j.sumAbsUs / j.steps), (unsigned long)j.overruns);
+    }
+    stepJitter = StepJitter{0, 0, 0, 0, 0};
+    lastJitterLog = now;
+  }
+}
+
+// esp_timer task context: just wake the motion task.
+void onStepTimer(void* arg) {
+  xTaskNotify((TaskHandle_t)arg, NOTIFY_STEP, eSetBits);
+}
+
+void onSchedTimer(void* arg) {
+  xTaskNotify((TaskHandle_t)arg, NOTIFY_SCHED, eSetBits);
+}
+
+// A scheduled command steps the moment it starts; restart the step timer so
+// the next step is a full period after it rather than whenever the old
+// phase says.
+void realignSteps() {
+  esp_timer_stop(stepTimer);
+  esp_timer_start_periodic(stepTimer, STEP_INTERVAL_US);
+  lastStepUs = esp_timer_get_time();
+}
+
+void taskMotion(void* pv) {
+  Serial.println("[MOTION] Started on core " + String(xPortGetCoreID()));
+
+  writeServos();
+
+  esp_timer_create_args_t args = {};
+  args.callback = onStepTimer;
+  args.arg = xTaskGetCurrentTaskHandle();
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "motion_step";
+  args.skip_unhandled_events = true;
+  if (esp_timer_create(&args, &stepTimer) != ESP_OK ||
+      esp_timer_start_periodic(stepTimer, STEP_INTERVAL_US) != ESP_OK) {
+    Serial.println("[MOTION] step timer failed");
+    vTaskDelete(nullptr);
+    return;
+  }
+  args.callback = onSchedTimer;
+  args.name = "motion_sched";
+  if (esp_timer_create(&args, &schedTimer) != ESP_OK) {
+    Serial.println("[MOTION] schedule timer failed");
+    vTaskDelete(nullptr);
+    return;
+  }
+  lastJitterLog = millis();
+  motionTask = xTaskGetCurrentTaskHandle();
+
+  while (true) {
+    uint32_t bits = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+    if (bits & NOTIFY_STEP) recordStepJitter(esp_timer_get_time());
+    unsigned long now = millis();
+    motionService(now);
+    bool step = bits & NOTIFY_STEP;
+    if (stepNow) {
+      stepNow = false;
+      if (!step) realignSteps();
+      step = true;
+    }
+    if (step) motionStep(now);
   }
 }
 
@@ -359,10 +1774,10 @@ void setup() {
   Serial.begin(115200);
   delay(200);
 
-  servoPan.attach(SERVO_PAN_PIN);
-  servoTilt.attach(SERVO_TILT_PIN);
-  servoPan.write(currentPan);
-  servoTilt.write(currentTilt);
+  // the library clamps writeMicroseconds() to the attach() range
+  servoPan.attach(SERVO_PAN_PIN, PAN_CAL.minUs(), PAN_CAL.maxUs());
+  servoTilt.attach(SERVO_TILT_PIN, TILT_CAL.minUs(), TILT_CAL.maxUs());
+  writeServos();
 
   WiFi.begin(WIFI_SSID, WIFI_PASS);
   Serial.printf("[WIFI] Connecting '%s' ...\n", WIFI_SSID);
@@ -389,5 +1804,7 @@ void setup() {
 
 void loop() {
   webSocket.loop();
+  drainStatus();
+  syncService();
   delay(2);
 }
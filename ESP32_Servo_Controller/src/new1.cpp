@@ -19,6 +19,7 @@
 #include <ArduinoJson.h>
 #include <ESP32Servo.h>
 #include <deque>
+#include "json_arena.h"
 
 // ---------- CONFIG ----------
 const char* WIFI_SSID = "Control_and_Command";
@@ -40,6 +41,7 @@ const int TILT_MIN_SAFE = 45;  // minimum tilt for safety
 const int STEP_INTERVAL_MS = 15;
 const int STEP_SIZE = 1;
 const unsigned long COMMAND_TIMEOUT_MS = 4000UL;
+const size_t JSON_RX_ARENA_BYTES = 8192;   // parse arena for one inbound frame
 // --------------------------------
 
 WebSocketsClient webSocket;
@@ -78,6 +80,21 @@ void sendJSON(const JsonDocument &doc);
 void sendAck(const String &id);
 void sendStatus(const String &id, const char* state, const char* error = nullptr);
 
+// Inbound frames are parsed straight from the client's buffer into an
+// arena-backed document: no String copy, no heap allocation per message.
+JsonArena<JSON_RX_ARENA_BYTES> rxArena;
+JsonDocument rxDoc(&rxArena);
+
+DeserializationError ingestJSON(const uint8_t* payload, size_t length) {
+  Serial.print("[WS RX] ");
+  Serial.write(payload, length);
+  Serial.println();
+
+  rxDoc.clear();
+  rxArena.reset();
+  return deserializeJson(rxDoc, (const char*)payload, length);
+}
+
 // ---------- WebSocket callbacks on core0 ----------
 void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
   if (type == WStype_CONNECTED) {
@@ -88,12 +105,9 @@ void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
     sendJSON(doc);
 
   } else if (type == WStype_TEXT) {
-    String msg = String((char*)payload);
-    Serial.println("[WS RX] " + msg);
-
-    StaticJsonDocument<512> doc;
-    DeserializationError err = deserializeJson(doc, msg);
+    DeserializationError err = ingestJSON(payload, length);
     if (err) return;
+    JsonDocument &doc = rxDoc;
 
     const char* t = doc["type"] | "";
 